@@ -0,0 +1,250 @@
+// Break-even benchmark for stream compression (kCompressionThreshold in
+// src/grpc/daemon_client.cpp).
+//
+// A generic gRPC server answers each call with a payload of the requested
+// size, compressed the same way the daemon compresses stream events
+// (GRPC_COMPRESS_LEVEL_LOW plus set_no_compression() per write when off).
+// Every size is fetched plain and compressed over a unix socket and over
+// TCP, and the median round trip is reported.
+//
+// Usage: clipboard-compression-bench [tcp-address]
+// Pass the address of a remote host running the same binary with
+// --serve <address> to measure a real link instead of loopback.
+
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+constexpr const char* kPlainMethod = "/bench.Payload/Plain";
+constexpr const char* kCompressedMethod = "/bench.Payload/Compressed";
+constexpr int kMaxMessageSize = 64 * 1024 * 1024;
+constexpr size_t kMaxPayloadSize = 16 * 1024 * 1024;
+
+// Roughly what a clipboard holds: prose, code and paths. Deflates to about
+// a third, like typical copied text.
+std::string make_text(size_t size) {
+    static const std::vector<std::string> words = {
+        "the", "clipboard", "manager", "std::string", "return", "const", "auto",
+        "/home/user/projects/", "error:", "void", "int64_t", "if (", ") {", "}\n",
+        "    ", "=", "->", "Summary", "of", "and", "content", "value", "for",
+        "https://example.com/", "item", "while", "true", "false", "nullptr;\n"};
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> pick(0, words.size() - 1);
+    std::uniform_int_distribution<int> digit('0', '9');
+    std::string text;
+    text.reserve(size + 32);
+    while (text.size() < size) {
+        text += words[pick(rng)];
+        text += ' ';
+        if (pick(rng) == 0) {
+            for (int i = 0; i < 6; ++i) {
+                text += static_cast<char>(digit(rng));
+            }
+        }
+    }
+    text.resize(size);
+    return text;
+}
+
+grpc::ByteBuffer to_buffer(const std::string& bytes) {
+    grpc::Slice slice(bytes);
+    return grpc::ByteBuffer(&slice, 1);
+}
+
+// Replies to one request with the first N bytes of the shared payload
+class PayloadReactor : public grpc::ServerGenericBidiReactor {
+public:
+    PayloadReactor(grpc::GenericCallbackServerContext* context, const std::string& payload)
+        : payload_(payload)
+        , compress_(context->method() == kCompressedMethod) {
+        if (compress_) {
+            context->set_compression_level(GRPC_COMPRESS_LEVEL_LOW);
+        }
+        StartRead(&request_);
+    }
+
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "missing request"));
+            return;
+        }
+        std::vector<grpc::Slice> slices;
+        std::string bytes;
+        if (request_.Dump(&slices).ok()) {
+            for (const auto& slice : slices) {
+                bytes.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+            }
+        }
+        uint64_t size = 0;
+        if (bytes.size() != sizeof(size)) {
+            Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "bad request"));
+            return;
+        }
+        std::memcpy(&size, bytes.data(), sizeof(size));
+        grpc::Slice reply(payload_.data(), std::min<size_t>(size, payload_.size()));
+        reply_ = grpc::ByteBuffer(&reply, 1);
+
+        grpc::WriteOptions options;
+        if (!compress_) {
+            options.set_no_compression();
+        }
+        StartWriteAndFinish(&reply_, options, grpc::Status::OK);
+    }
+
+    void OnDone() override { delete this; }
+
+private:
+    const std::string& payload_;
+    const bool compress_;
+    grpc::ByteBuffer request_;
+    grpc::ByteBuffer reply_;
+};
+
+class PayloadService : public grpc::CallbackGenericService {
+public:
+    explicit PayloadService(std::string payload) : payload_(std::move(payload)) {}
+
+    grpc::ServerGenericBidiReactor* CreateReactor(grpc::GenericCallbackServerContext* context) override {
+        return new PayloadReactor(context, payload_);
+    }
+
+private:
+    const std::string payload_;
+};
+
+// A generic service can only be registered once, so one server listens on
+// every address
+std::unique_ptr<grpc::Server> start_server(PayloadService& service,
+                                           const std::vector<std::string>& addresses,
+                                           int* selected_port) {
+    grpc::ServerBuilder builder;
+    for (const auto& address : addresses) {
+        builder.AddListeningPort(address, grpc::InsecureServerCredentials(), selected_port);
+    }
+    builder.SetMaxSendMessageSize(kMaxMessageSize);
+    builder.RegisterCallbackGenericService(&service);
+    return builder.BuildAndStart();
+}
+
+// Median wall time of one call, including copying the reply out like the
+// client does when it parses an event
+double time_call(grpc::GenericStub& stub, const char* method, uint64_t size, int iterations) {
+    std::string request_bytes(sizeof(size), '\0');
+    std::memcpy(request_bytes.data(), &size, sizeof(size));
+
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (int i = 0; i < iterations; ++i) {
+        grpc::ClientContext context;
+        grpc::ByteBuffer request = to_buffer(request_bytes);
+        grpc::ByteBuffer reply;
+        std::promise<grpc::Status> done;
+
+        auto start = std::chrono::steady_clock::now();
+        stub.UnaryCall(&context, method, grpc::StubOptions(), &request, &reply,
+                       [&done](grpc::Status status) { done.set_value(std::move(status)); });
+        grpc::Status status = done.get_future().get();
+        std::vector<grpc::Slice> slices;
+        std::string received;
+        if (status.ok() && reply.Dump(&slices).ok()) {
+            received.reserve(reply.Length());
+            for (const auto& slice : slices) {
+                received.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+            }
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        if (!status.ok() || received.size() != size) {
+            std::cerr << "call failed: " << status.error_message() << std::endl;
+            return -1;
+        }
+        samples.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+    }
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+void run(const std::string& transport, const std::string& target) {
+    grpc::ChannelArguments args;
+    args.SetMaxReceiveMessageSize(kMaxMessageSize);
+    auto channel = grpc::CreateCustomChannel(target, grpc::InsecureChannelCredentials(), args);
+    grpc::GenericStub stub(channel);
+
+    std::cout << "\n" << transport << " (" << target << ")\n"
+              << std::setw(10) << "bytes" << std::setw(14) << "plain us"
+              << std::setw(14) << "deflate us" << std::setw(10) << "ratio" << "\n";
+
+    size_t break_even = 0;
+    for (size_t size = 1024; size <= kMaxPayloadSize; size *= 2) {
+        // Enough calls for a stable median without spending minutes on 16 MiB
+        int iterations = static_cast<int>(std::clamp<size_t>((64 * 1024 * 1024) / size, 15, 400));
+        time_call(stub, kPlainMethod, size, 3);
+        double plain = time_call(stub, kPlainMethod, size, iterations);
+        time_call(stub, kCompressedMethod, size, 3);
+        double compressed = time_call(stub, kCompressedMethod, size, iterations);
+        if (plain < 0 || compressed < 0) {
+            return;
+        }
+        if (compressed < plain) {
+            if (break_even == 0) {
+                break_even = size;
+            }
+        } else {
+            break_even = 0;
+        }
+        std::cout << std::setw(10) << size << std::fixed << std::setprecision(1)
+                  << std::setw(14) << plain << std::setw(14) << compressed
+                  << std::setw(9) << std::setprecision(2) << compressed / plain << "\n";
+    }
+    if (break_even != 0) {
+        std::cout << "compression wins from " << break_even << " bytes\n";
+    } else {
+        std::cout << "compression never wins up to " << kMaxPayloadSize << " bytes\n";
+    }
+}
+}
+
+int main(int argc, char** argv) {
+    PayloadService service(make_text(kMaxPayloadSize));
+
+    if (argc == 3 && std::string(argv[1]) == "--serve") {
+        int port = 0;
+        auto server = start_server(service, {argv[2]}, &port);
+        if (!server) {
+            std::cerr << "failed to listen on " << argv[2] << std::endl;
+            return 1;
+        }
+        std::cout << "serving on " << argv[2] << std::endl;
+        server->Wait();
+        return 0;
+    }
+
+    std::string unix_address = "unix:/tmp/clipboard-compression-bench-" + std::to_string(getpid()) + ".sock";
+    int port = 0;
+    // The TCP port is listed last so selected_port reports it
+    auto server = start_server(service, {unix_address, "127.0.0.1:0"}, &port);
+    if (!server) {
+        std::cerr << "failed to start the local servers" << std::endl;
+        return 1;
+    }
+
+    run("unix socket", unix_address);
+    run("tcp", argc > 1 ? argv[1] : "127.0.0.1:" + std::to_string(port));
+
+    server->Shutdown();
+    unlink(unix_address.substr(5).c_str());
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Insert/get throughput of ClipboardDB on a 50k-item history.
+//
+// The history is built the way ClipboardService::process_event stores an
+// event: a ClipboardDB::content_exists duplicate check, then
+// ClipboardDB::insert with its hashes and FTS update. Every item is then
+// read back through ClipboardDB::get. The same lookup is finally run on a plain connection,
+// once preparing the statement on every call as ClipboardDB did before the
+// StatementCache and once through a StatementCache, to show what reusing
+// statements is worth on its own.
+//
+// Usage: clipboard-database-bench [db-path] [items]
+// The database at db-path is deleted before and after the run.
+
+#include "database/clipboard_db.h"
+#include "database/statement_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+constexpr int kDefaultItems = 50000;
+
+// Matches ClipboardDB::get so both lookups do the same work
+constexpr const char* kGetSql = R"(
+    SELECT id, content, content_type, ocr_text, embedding, source_app, timestamp, is_password, is_encrypted, metadata, thumbnail, code_language
+    FROM clipboard_items WHERE id = ?
+)";
+
+void remove_database(const std::string& path) {
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        unlink((path + suffix).c_str());
+    }
+}
+
+// A few hundred bytes of text, unique per item like real clipboard history
+std::vector<uint8_t> make_content(int index, std::mt19937& rng) {
+    static const char* words[] = {"clipboard", "history", "return", "const", "value", "https://example.com/",
+                                  "the", "item", "error:", "std::vector", "build", "and", "of", "search"};
+    std::uniform_int_distribution<size_t> pick(0, std::size(words) - 1);
+    std::uniform_int_distribution<int> length(20, 80);
+    std::string text = "#";
+    text += std::to_string(index);
+    for (int i = length(rng); i > 0; --i) {
+        text += ' ';
+        text += words[pick(rng)];
+    }
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+// Steps the lookup and reads the columns ClipboardDB::get copies out
+bool read_item(sqlite3_stmt* stmt, int64_t id) {
+    sqlite3_bind_int64(stmt, 1, id);
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        return false;
+    }
+    for (int column = 0; column < sqlite3_column_count(stmt); ++column) {
+        sqlite3_column_blob(stmt, column);
+        sqlite3_column_bytes(stmt, column);
+    }
+    return true;
+}
+
+double micros_per_op(std::chrono::steady_clock::duration elapsed, int operations) {
+    return std::chrono::duration<double, std::micro>(elapsed).count() / operations;
+}
+
+void report(const char* label, double micros) {
+    std::cout << std::left << std::setw(34) << label << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << micros << " us/op" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+    const std::string path = argc > 1 ? argv[1] : "/tmp/clipboard-database-bench.db";
+    const int items = argc > 2 ? std::max(1, std::atoi(argv[2])) : kDefaultItems;
+    remove_database(path);
+
+    std::vector<int64_t> ids;
+    ids.reserve(items);
+    {
+        ClipboardDB db(path);
+        if (!db.initialize()) {
+            std::cerr << "failed to open " << path << std::endl;
+            return 1;
+        }
+
+        std::mt19937 rng(42);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < items; ++i) {
+            ClipboardItem item;
+            item.content = make_content(i, rng);
+            item.content_type = "Text";
+            item.source_app = "bench";
+            item.timestamp = i;
+            if (db.content_exists(item.content)) {
+                std::cerr << "item " << i << " reported as a duplicate" << std::endl;
+                return 1;
+            }
+            int64_t id = db.insert(item);
+            if (id <= 0) {
+                std::cerr << "insert " << i << " failed" << std::endl;
+                return 1;
+            }
+            ids.push_back(id);
+        }
+        report("content_exists + insert", micros_per_op(std::chrono::steady_clock::now() - start, items));
+
+        std::shuffle(ids.begin(), ids.end(), rng);
+        start = std::chrono::steady_clock::now();
+        for (int64_t id : ids) {
+            if (!db.get(id)) {
+                std::cerr << "get " << id << " failed" << std::endl;
+                return 1;
+            }
+        }
+        report("ClipboardDB::get", micros_per_op(std::chrono::steady_clock::now() - start, items));
+    }
+
+    sqlite3* connection = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &connection, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "failed to reopen " << path << std::endl;
+        sqlite3_close(connection);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t id : ids) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(connection, kGetSql, -1, &stmt, nullptr) != SQLITE_OK || !read_item(stmt, id)) {
+            std::cerr << "lookup " << id << " failed: " << sqlite3_errmsg(connection) << std::endl;
+        }
+        sqlite3_finalize(stmt);
+    }
+    report("lookup, prepared per call", micros_per_op(std::chrono::steady_clock::now() - start, items));
+
+    {
+        StatementCache statements(connection);
+        start = std::chrono::steady_clock::now();
+        for (int64_t id : ids) {
+            auto statement = statements.acquire(kGetSql);
+            if (!statement || !read_item(statement.get(), id)) {
+                std::cerr << "lookup " << id << " failed: " << sqlite3_errmsg(connection) << std::endl;
+            }
+        }
+        report("lookup, StatementCache", micros_per_op(std::chrono::steady_clock::now() - start, items));
+    }
+
+    sqlite3_close(connection);
+    remove_database(path);
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include "app/bootstrap.h"
 
+#include <csignal>
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
@@ -15,6 +16,10 @@ AppBootstrap::AppBootstrap() = default;
 int AppBootstrap::run(int argc, char* argv[]) {
     std::cout << "Clipboard Manager C++ (Wayland Native)" << std::endl;
 
+    // Helpers like wl-copy may exit before reading what we pipe to them;
+    // the write has to fail instead of killing the app
+    std::signal(SIGPIPE, SIG_IGN);
+
     initialize_core();
     connect_activation();
 
@@ -41,6 +46,10 @@ void AppBootstrap::initialize_core() {
 
     std::cout << "🔧 Setting up daemon client..." << std::endl;
     daemon_client_ = std::make_shared<DaemonClient>("unix:///tmp/clipboard-daemon.sock");
+    clipboard_service_->set_clipboard_writer(
+        [client = daemon_client_](const std::vector<uint8_t>& data, const std::string& mime_type) {
+            return client->set_clipboard_content(data, mime_type);
+        });
     std::cout << "✅ Daemon client configured" << std::endl;
 }
 
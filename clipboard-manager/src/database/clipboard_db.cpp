@@ -1,4 +1,6 @@
 #include "clipboard_db.h"
+#include "update_queue.h"
+#include "content_hash.h"
 #include <iostream>
 #include <cstring>
 #include <sstream>
@@ -8,51 +10,71 @@
 
 ClipboardDB::ClipboardDB(const std::string& db_path) : db_path_(db_path) {}
 
-ClipboardDB::~ClipboardDB() {
-    if (db_) {
-        sqlite3_close(db_);
-    }
-}
+ClipboardDB::~ClipboardDB() = default;
 
 // Forward declaration for schema migration helper
 static bool migrate_schema(sqlite3* db);
 
 bool ClipboardDB::initialize() {
-    int rc = sqlite3_open(db_path_.c_str(), &db_);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to open database: " << sqlite3_errmsg(db_) << std::endl;
+    auto pool = std::make_unique<ConnectionPool>(db_path_, kReaderConnections);
+    if (!pool->open_writer()) {
         return false;
     }
-    // Apply PRAGMAs to match .NET settings
-    const char* pragmas = R"(
-        PRAGMA journal_mode = WAL;
-        PRAGMA synchronous = NORMAL;
-        PRAGMA cache_size = -64000;
-        PRAGMA temp_store = MEMORY;
-        PRAGMA foreign_keys = ON;
-    )";
-    char* err_msg = nullptr;
-    int prc = sqlite3_exec(db_, pragmas, nullptr, nullptr, &err_msg);
-    if (prc != SQLITE_OK) {
-        std::cerr << "Failed to apply PRAGMAs: " << err_msg << std::endl;
-        sqlite3_free(err_msg);
-        // continue, but warn
-    }
 
-    if (!create_tables()) return false;
+    {
+        auto writer = pool->write();
+        sqlite3* db = writer.db();
+
+        // Apply PRAGMAs to match .NET settings
+        const char* pragmas = R"(
+            PRAGMA journal_mode = WAL;
+            PRAGMA synchronous = NORMAL;
+            PRAGMA cache_size = -64000;
+            PRAGMA temp_store = MEMORY;
+            PRAGMA foreign_keys = ON;
+        )";
+        char* err_msg = nullptr;
+        int prc = sqlite3_exec(db, pragmas, nullptr, nullptr, &err_msg);
+        if (prc != SQLITE_OK) {
+            std::cerr << "Failed to apply PRAGMAs: " << err_msg << std::endl;
+            sqlite3_free(err_msg);
+            // continue, but warn
+        }
+
+        if (!create_tables(db)) return false;
+
+        // Migrate existing schema (add missing columns) before creating indexes
+        if (!migrate_schema(db)) {
+            std::cerr << "Failed to migrate database schema" << std::endl;
+            return false;
+        }
+
+        if (!create_indexes(db)) return false;
+    }
 
-    // Migrate existing schema (add missing columns) before creating indexes
-    if (!migrate_schema(db_)) {
-        std::cerr << "Failed to migrate database schema" << std::endl;
+    // Readers open the file in the WAL mode set up above
+    if (!pool->open_readers()) {
+        std::cerr << "Failed to open database reader connections" << std::endl;
         return false;
     }
 
-    if (!create_indexes()) return false;
+    pool_ = std::move(pool);
+
+    update_queue_ = std::make_unique<UpdateQueue>([this](const std::vector<ItemUpdate>& updates) {
+        if (!apply_updates(updates)) return;
+
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(updates_committed_mutex_);
+            callback = updates_committed_callback_;
+        }
+        if (callback) callback();
+    });
 
     return true;
 }
 
-bool ClipboardDB::create_tables() {
+bool ClipboardDB::create_tables(sqlite3* db) {
     // Schema MUST match .NET Schema.sql exactly - NO triggers (FTS updated manually in code)
     const char* sql = R"(
         CREATE TABLE IF NOT EXISTS clipboard_items (
@@ -81,7 +103,7 @@ bool ClipboardDB::create_tables() {
     )";
     
     char* err_msg = nullptr;
-    int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &err_msg);
+    int rc = sqlite3_exec(db, sql, nullptr, nullptr, &err_msg);
     if (rc != SQLITE_OK) {
         std::cerr << "SQL error: " << err_msg << std::endl;
         sqlite3_free(err_msg);
@@ -92,6 +114,86 @@ bool ClipboardDB::create_tables() {
 }
 
 
+// Same hash the daemon sends as ClipboardEvent.content_hash, so either one can
+// be stored and looked up
+static std::string hash_hex(const void* data, size_t size) {
+    clipboard::ContentHasher hasher;
+    hasher.Update(static_cast<const uint8_t*>(data), size);
+    return hasher.Finish().ToHex();
+}
+
+static std::string content_hash_of(const ClipboardItem& item) {
+    return item.content_hash.empty() ? hash_hex(item.content.data(), item.content.size()) : item.content_hash;
+}
+
+// OCR text is matched against copied text ignoring surrounding whitespace;
+// empty after trimming means there is nothing to match
+static std::string ocr_hash_of(const std::string& ocr_text) {
+    auto start = ocr_text.find_first_not_of(" \t\n\r");
+    if (start == std::string::npos) return std::string();
+    auto end = ocr_text.find_last_not_of(" \t\n\r");
+    return hash_hex(ocr_text.data() + start, end - start + 1);
+}
+
+static void bind_hash(sqlite3_stmt* stmt, int index, const std::string& hash) {
+    if (!hash.empty()) {
+        sqlite3_bind_text(stmt, index, hash.c_str(), -1, SQLITE_TRANSIENT);
+    } else {
+        sqlite3_bind_null(stmt, index);
+    }
+}
+
+// Hashes rows that have none yet: those written before the hash columns
+// existed, and those written by the .NET app, which does not know them
+static bool backfill_hashes(sqlite3* db) {
+    std::vector<int64_t> ids;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id FROM clipboard_items WHERE content_hash IS NULL", -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Hash backfill SQL error: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        ids.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    if (ids.empty()) return true;
+
+    sqlite3_stmt* select_stmt = nullptr;
+    sqlite3_stmt* update_stmt = nullptr;
+    bool ok = sqlite3_prepare_v2(db, "SELECT content, ocr_text FROM clipboard_items WHERE id = ?", -1, &select_stmt, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(db, "UPDATE clipboard_items SET content_hash = ?, ocr_hash = ? WHERE id = ?", -1, &update_stmt, nullptr) == SQLITE_OK &&
+              sqlite3_exec(db, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) == SQLITE_OK;
+
+    for (size_t i = 0; ok && i < ids.size(); i++) {
+        sqlite3_bind_int64(select_stmt, 1, ids[i]);
+        if (sqlite3_step(select_stmt) == SQLITE_ROW) {
+            const void* content = sqlite3_column_blob(select_stmt, 0);
+            int content_size = sqlite3_column_bytes(select_stmt, 0);
+            const char* ocr = reinterpret_cast<const char*>(sqlite3_column_text(select_stmt, 1));
+
+            bind_hash(update_stmt, 1, hash_hex(content, content_size));
+            bind_hash(update_stmt, 2, ocr ? ocr_hash_of(ocr) : std::string());
+            sqlite3_bind_int64(update_stmt, 3, ids[i]);
+            ok = sqlite3_step(update_stmt) == SQLITE_DONE;
+            sqlite3_reset(update_stmt);
+        }
+        sqlite3_reset(select_stmt);
+    }
+
+    if (!ok) {
+        std::cerr << "Hash backfill SQL error: " << sqlite3_errmsg(db) << std::endl;
+    }
+    sqlite3_finalize(select_stmt);
+    sqlite3_finalize(update_stmt);
+    if (sqlite3_get_autocommit(db) == 0) {
+        sqlite3_exec(db, ok ? "COMMIT" : "ROLLBACK", nullptr, nullptr, nullptr);
+    }
+    if (ok) {
+        std::cout << "🔧 DB: Hashed " << ids.size() << " existing items" << std::endl;
+    }
+    return ok;
+}
+
 // Ensure the clipboard_items table has the columns expected by the .NET schema.
 static bool migrate_schema(sqlite3* db) {
     // Read existing columns
@@ -146,19 +248,30 @@ static bool migrate_schema(sqlite3* db) {
         if (!exec("ALTER TABLE clipboard_items ADD COLUMN code_language TEXT")) return false;
     }
 
-    return true;
+    // Not part of the .NET schema: hashes for indexed duplicate detection
+    if (!cols.count("content_hash")) {
+        if (!exec("ALTER TABLE clipboard_items ADD COLUMN content_hash TEXT")) return false;
+    }
+
+    if (!cols.count("ocr_hash")) {
+        if (!exec("ALTER TABLE clipboard_items ADD COLUMN ocr_hash TEXT")) return false;
+    }
+
+    return backfill_hashes(db);
 }
 
-bool ClipboardDB::create_indexes() {
+bool ClipboardDB::create_indexes(sqlite3* db) {
     const char* sql = R"(
         CREATE INDEX IF NOT EXISTS idx_timestamp ON clipboard_items(timestamp DESC);
         CREATE INDEX IF NOT EXISTS idx_content_type ON clipboard_items(content_type);
         CREATE INDEX IF NOT EXISTS idx_password ON clipboard_items(is_password);
         CREATE INDEX IF NOT EXISTS idx_source_app ON clipboard_items(source_app);
+        CREATE INDEX IF NOT EXISTS idx_content_hash ON clipboard_items(content_hash);
+        CREATE INDEX IF NOT EXISTS idx_ocr_hash ON clipboard_items(ocr_hash) WHERE ocr_hash IS NOT NULL;
     )";
     
     char* err_msg = nullptr;
-    int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &err_msg);
+    int rc = sqlite3_exec(db, sql, nullptr, nullptr, &err_msg);
     if (rc != SQLITE_OK) {
         std::cerr << "SQL error: " << err_msg << std::endl;
         sqlite3_free(err_msg);
@@ -170,15 +283,16 @@ bool ClipboardDB::create_indexes() {
 
 
 // Helper to update FTS manually (like .NET does)
-static bool update_fts(sqlite3* db, int64_t id, const ClipboardItem& item) {
+static bool update_fts(const ConnectionLease& connection, int64_t id, const ClipboardItem& item) {
     // Use INSERT OR REPLACE for compatibility with .NET which may have already inserted
     const char* sql = R"(
         INSERT OR REPLACE INTO clipboard_fts(rowid, content, ocr_text, code_language, source_app)
         VALUES (?, ?, ?, ?, ?)
     )";
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "❌ FTS update prepare failed: " << sqlite3_errmsg(db) << std::endl;
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
+        std::cerr << "❌ FTS update prepare failed: " << sqlite3_errmsg(connection.db()) << std::endl;
         return false;
     }
     sqlite3_bind_int64(stmt, 1, id);
@@ -192,9 +306,8 @@ static bool update_fts(sqlite3* db, int64_t id, const ClipboardItem& item) {
     sqlite3_bind_text(stmt, 4, item.code_language.c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 5, item.source_app.c_str(), -1, SQLITE_TRANSIENT);
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
     if (rc != SQLITE_DONE) {
-        std::cerr << "❌ FTS update failed: " << sqlite3_errmsg(db) << std::endl;
+        std::cerr << "❌ FTS update failed: " << sqlite3_errmsg(connection.db()) << std::endl;
         return false;
     }
     return true;
@@ -203,13 +316,15 @@ static bool update_fts(sqlite3* db, int64_t id, const ClipboardItem& item) {
 int64_t ClipboardDB::insert(const ClipboardItem& item) {
     // Schema matches .NET exactly - no 'type' column
     const char* sql = R"(
-        INSERT INTO clipboard_items (content, content_type, ocr_text, embedding, source_app, timestamp, is_password, is_encrypted, metadata, thumbnail, code_language)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO clipboard_items (content, content_type, ocr_text, embedding, source_app, timestamp, is_password, is_encrypted, metadata, thumbnail, code_language, content_hash, ocr_hash)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )";
     
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "❌ DB Insert prepare failed: " << sqlite3_errmsg(db_) << std::endl;
+    auto connection = pool_->write();
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
+        std::cerr << "❌ DB Insert prepare failed: " << sqlite3_errmsg(connection.db()) << std::endl;
         return -1;
     }
     
@@ -251,20 +366,20 @@ int64_t ClipboardDB::insert(const ClipboardItem& item) {
     }
 
     sqlite3_bind_text(stmt, 11, item.code_language.c_str(), -1, SQLITE_TRANSIENT);
+    bind_hash(stmt, 12, content_hash_of(item));
+    bind_hash(stmt, 13, ocr_hash_of(item.ocr_text));
     
     int rc = sqlite3_step(stmt);
     
     if (rc != SQLITE_DONE) {
-        std::cerr << "❌ DB Insert failed: " << sqlite3_errmsg(db_) << " (code: " << rc << ")" << std::endl;
-        sqlite3_finalize(stmt);
+        std::cerr << "❌ DB Insert failed: " << sqlite3_errmsg(connection.db()) << " (code: " << rc << ")" << std::endl;
         return -1;
     }
     
-    int64_t id = sqlite3_last_insert_rowid(db_);
-    sqlite3_finalize(stmt);
+    int64_t id = sqlite3_last_insert_rowid(connection.db());
     
     // Update FTS manually (like .NET does)
-    update_fts(db_, id, item);
+    update_fts(connection, id, item);
     
     return id;
 }
@@ -275,15 +390,16 @@ std::optional<ClipboardItem> ClipboardDB::get(int64_t id) {
         FROM clipboard_items WHERE id = ?
     )";
 
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto connection = pool_->read();
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
         return std::nullopt;
     }
 
     sqlite3_bind_int64(stmt, 1, id);
 
     if (sqlite3_step(stmt) != SQLITE_ROW) {
-        sqlite3_finalize(stmt);
         return std::nullopt;
     }
 
@@ -347,7 +463,6 @@ std::optional<ClipboardItem> ClipboardDB::get(int64_t id) {
         item.type = ClipboardType::Code;
     }
 
-    sqlite3_finalize(stmt);
     return item;
 }
 
@@ -363,88 +478,119 @@ std::optional<ClipboardItem> ClipboardDB::get(int64_t id) {
     }
 }
 
-std::vector<ClipboardItem> ClipboardDB::get_recent(int limit) {
-    std::cout << "🔧 DB: Getting recent items..." << std::endl;
-    std::vector<ClipboardItem> items;
-    
-    const char* sql = R"(
-        SELECT id, content, content_type, ocr_text, embedding, source_app, timestamp, is_password, is_encrypted, metadata, thumbnail, code_language
-        FROM clipboard_items ORDER BY timestamp DESC LIMIT ?
-    )";
-    
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "❌ DB: Failed to prepare: " << sqlite3_errmsg(db_) << std::endl;
-        return items;
-    }
-    
-    sqlite3_bind_int(stmt, 1, limit);
-    
-    std::cout << "🔧 DB: Executing query..." << std::endl;
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        std::cout << "🔧 DB: Reading row..." << std::endl;
-        ClipboardItem item;
-        item.id = sqlite3_column_int64(stmt, 0);
+// Columns read by read_summary(). The preview is cut in SQL so the content
+// never leaves SQLite.
+static const char* const kSummaryColumns = R"(
+    id, content_type, source_app, timestamp, code_language,
+    substr(CASE WHEN content_type = 'Image' THEN ocr_text ELSE CAST(content AS TEXT) END, 1, ?),
+    thumbnail
+)";
 
-        const void* blob = sqlite3_column_blob(stmt, 1);
-        int blob_size = sqlite3_column_bytes(stmt, 1);
-        if (blob && blob_size > 0) item.content.assign(static_cast<const uint8_t*>(blob), static_cast<const uint8_t*>(blob) + blob_size);
+static ClipboardItemSummary read_summary(sqlite3_stmt* stmt) {
+    ClipboardItemSummary summary;
+    summary.id = sqlite3_column_int64(stmt, 0);
 
-        const char* ctype = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        if (ctype) {
-            item.content_type = ctype;
-            // Parsear tipo como .NET: "Text", "Code", "Image", "Url"
-            std::string ct = ctype;
-            if (ct == "Code") {
-                item.type = ClipboardType::Code;
-            } else if (ct == "Image") {
-                item.type = ClipboardType::Image;
-            } else if (ct == "Url") {
-                item.type = ClipboardType::URL;
-            } else {
-                item.type = ClipboardType::Text;
-            }
+    const char* ctype = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    if (ctype) {
+        summary.content_type = ctype;
+        std::string ct = ctype;
+        if (ct == "Code") {
+            summary.type = ClipboardType::Code;
+        } else if (ct == "Image") {
+            summary.type = ClipboardType::Image;
+        } else if (ct == "Url") {
+            summary.type = ClipboardType::URL;
         }
+    }
 
-        if (sqlite3_column_type(stmt, 3) != SQLITE_NULL) {
-            const char* ocr = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-            if (ocr) item.ocr_text = ocr;
-        }
+    const char* app = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+    if (app) summary.source_app = app;
 
-        const char* app = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        if (app) item.source_app = app;
+    summary.timestamp = sqlite3_column_int64(stmt, 3);
 
-        item.timestamp = sqlite3_column_int64(stmt, 6);
+    const char* lang = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+    if (lang) summary.code_language = lang;
 
-        if (sqlite3_column_type(stmt, 11) != SQLITE_NULL) {
-            const char* lang = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 11));
-            if (lang) item.code_language = lang;
-        }
-        
-        // Si tiene code_language, debe marcarse como Code (comportamiento original)
-        if (!item.code_language.empty()) {
-            item.type = ClipboardType::Code;
+    const char* preview = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+    if (preview) summary.preview.assign(preview, sqlite3_column_bytes(stmt, 5));
+
+    const void* thumbnail = sqlite3_column_blob(stmt, 6);
+    int thumbnail_size = sqlite3_column_bytes(stmt, 6);
+    if (thumbnail && thumbnail_size > 0) {
+        summary.thumbnail.assign(static_cast<const uint8_t*>(thumbnail), static_cast<const uint8_t*>(thumbnail) + thumbnail_size);
+    }
+
+    // Si tiene code_language, debe marcarse como Code (comportamiento original)
+    if (!summary.code_language.empty()) {
+        summary.type = ClipboardType::Code;
+    }
+
+    return summary;
+}
+
+std::vector<ClipboardItemSummary> ClipboardDB::get_recent_summaries(int limit) {
+    std::vector<ClipboardItemSummary> summaries;
+
+    const std::string sql = std::string("SELECT ") + kSummaryColumns +
+        " FROM clipboard_items ORDER BY timestamp DESC LIMIT ?";
+
+    auto connection = pool_->read();
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
+        std::cerr << "❌ DB: Failed to prepare: " << sqlite3_errmsg(connection.db()) << std::endl;
+        return summaries;
+    }
+
+    sqlite3_bind_int(stmt, 1, kSummaryPreviewChars);
+    sqlite3_bind_int(stmt, 2, limit);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        summaries.push_back(read_summary(stmt));
+    }
+
+    return summaries;
+}
+
+std::vector<ClipboardItemSummary> ClipboardDB::get_summaries(const std::vector<int64_t>& ids) {
+    std::vector<ClipboardItemSummary> summaries;
+    if (ids.empty()) return summaries;
+
+    const std::string sql = std::string("SELECT ") + kSummaryColumns + " FROM clipboard_items WHERE id = ?";
+
+    auto connection = pool_->read();
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
+        std::cerr << "❌ DB: Failed to prepare: " << sqlite3_errmsg(connection.db()) << std::endl;
+        return summaries;
+    }
+
+    // One primary key lookup per id keeps the caller's order
+    sqlite3_bind_int(stmt, 1, kSummaryPreviewChars);
+    for (int64_t id : ids) {
+        sqlite3_bind_int64(stmt, 2, id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            summaries.push_back(read_summary(stmt));
         }
-        
-        items.push_back(std::move(item));
-        std::cout << "✅ DB: Row added" << std::endl;
+        sqlite3_reset(stmt);
     }
-    
-    std::cout << "✅ DB: Loaded " << items.size() << " items" << std::endl;
-    sqlite3_finalize(stmt);
-    return items;
+
+    return summaries;
 }
 
 bool ClipboardDB::update(const ClipboardItem& item) {
     const char* sql = R"(
         UPDATE clipboard_items 
-        SET content = ?, content_type = ?, ocr_text = ?, embedding = ?, source_app = ?, timestamp = ?, is_password = ?, is_encrypted = ?, metadata = ?, thumbnail = ?, code_language = ?
+        SET content = ?, content_type = ?, ocr_text = ?, embedding = ?, source_app = ?, timestamp = ?, is_password = ?, is_encrypted = ?, metadata = ?, thumbnail = ?, code_language = ?, content_hash = ?, ocr_hash = ?
         WHERE id = ?
     )";
     
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "❌ DB Update prepare failed: " << sqlite3_errmsg(db_) << std::endl;
+    auto connection = pool_->write();
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
+        std::cerr << "❌ DB Update prepare failed: " << sqlite3_errmsg(connection.db()) << std::endl;
         return false;
     }
     
@@ -489,28 +635,174 @@ bool ClipboardDB::update(const ClipboardItem& item) {
 
     sqlite3_bind_text(stmt, 11, item.code_language.c_str(), -1, SQLITE_TRANSIENT);
 
-    sqlite3_bind_int64(stmt, 12, item.id);
+    // Items read back carry no hash, so it is always taken from the content
+    bind_hash(stmt, 12, hash_hex(item.content.data(), item.content.size()));
+    bind_hash(stmt, 13, ocr_hash_of(item.ocr_text));
+
+    sqlite3_bind_int64(stmt, 14, item.id);
     
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
     
     if (rc != SQLITE_DONE) {
-        std::cerr << "❌ DB Update failed: " << sqlite3_errmsg(db_) << std::endl;
+        std::cerr << "❌ DB Update failed: " << sqlite3_errmsg(connection.db()) << std::endl;
         return false;
     }
 
     // Keep FTS synchronized with updated OCR/language/text fields.
-    update_fts(db_, item.id, item);
+    update_fts(connection, item.id, item);
     
     return true;
 }
 
+void ItemUpdate::merge(ItemUpdate&& newer) {
+    if (newer.type) type = std::move(newer.type);
+    if (newer.ocr_text) ocr_text = std::move(newer.ocr_text);
+    if (newer.code_language) code_language = std::move(newer.code_language);
+    if (newer.embedding) embedding = std::move(newer.embedding);
+    if (newer.thumbnail) thumbnail = std::move(newer.thumbnail);
+}
+
+// Stored content_type names, as .NET writes them
+static const char* content_type_name(ClipboardType type) {
+    switch (type) {
+        case ClipboardType::Code: return "Code";
+        case ClipboardType::Image: return "Image";
+        case ClipboardType::URL: return "Url";
+        default: return "Text";
+    }
+}
+
+// Writes only the columns the update sets, then rebuilds the item's FTS row
+// from the stored one if a searchable column changed
+static bool apply_update(const ConnectionLease& connection, const ItemUpdate& update) {
+    std::string sql = "UPDATE clipboard_items SET ";
+    std::string separator;
+    for (auto [set, column] : {std::pair{update.type.has_value(), "content_type"},
+                               std::pair{update.ocr_text.has_value(), "ocr_text"},
+                               std::pair{update.ocr_text.has_value(), "ocr_hash"},
+                               std::pair{update.code_language.has_value(), "code_language"},
+                               std::pair{update.embedding.has_value(), "embedding"},
+                               std::pair{update.thumbnail.has_value(), "thumbnail"}}) {
+        if (set) {
+            sql += separator + column + " = ?";
+            separator = ", ";
+        }
+    }
+    if (separator.empty()) return true;
+    sql += " WHERE id = ?";
+
+    // At most one statement per column combination ends up in the cache
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
+        std::cerr << "❌ DB Update prepare failed: " << sqlite3_errmsg(connection.db()) << std::endl;
+        return false;
+    }
+
+    int index = 1;
+    if (update.type) {
+        sqlite3_bind_text(stmt, index++, content_type_name(*update.type), -1, SQLITE_STATIC);
+    }
+    std::string ocr_hash;
+    if (update.ocr_text) {
+        ocr_hash = ocr_hash_of(*update.ocr_text);
+        sqlite3_bind_text(stmt, index++, update.ocr_text->c_str(), -1, SQLITE_STATIC);
+        bind_hash(stmt, index++, ocr_hash);
+    }
+    if (update.code_language) {
+        sqlite3_bind_text(stmt, index++, update.code_language->c_str(), -1, SQLITE_STATIC);
+    }
+    if (update.embedding) {
+        if (!update.embedding->empty()) {
+            sqlite3_bind_blob(stmt, index++, update.embedding->data(), update.embedding->size() * sizeof(float), SQLITE_STATIC);
+        } else {
+            sqlite3_bind_null(stmt, index++);
+        }
+    }
+    if (update.thumbnail) {
+        if (!update.thumbnail->empty()) {
+            sqlite3_bind_blob(stmt, index++, update.thumbnail->data(), update.thumbnail->size(), SQLITE_STATIC);
+        } else {
+            sqlite3_bind_null(stmt, index++);
+        }
+    }
+    sqlite3_bind_int64(stmt, index, update.id);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "❌ DB Update failed: " << sqlite3_errmsg(connection.db()) << std::endl;
+        return false;
+    }
+
+    if (!update.ocr_text && !update.code_language) return true;
+
+    // Same row update_fts() writes, without reading the content back out
+    const char* fts_sql = R"(
+        INSERT OR REPLACE INTO clipboard_fts(rowid, content, ocr_text, code_language, source_app)
+        SELECT id, CASE WHEN content_type = 'Image' THEN '' ELSE CAST(content AS TEXT) END,
+               COALESCE(ocr_text, ''), COALESCE(code_language, ''), COALESCE(source_app, '')
+        FROM clipboard_items WHERE id = ?
+    )";
+    auto fts_statement = connection.prepare(fts_sql);
+    stmt = fts_statement.get();
+    if (!stmt) {
+        std::cerr << "❌ FTS update prepare failed: " << sqlite3_errmsg(connection.db()) << std::endl;
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, update.id);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "❌ FTS update failed: " << sqlite3_errmsg(connection.db()) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ClipboardDB::queue_update(ItemUpdate update) {
+    if (update_queue_) {
+        update_queue_->push(std::move(update));
+    } else {
+        apply_updates({std::move(update)});
+    }
+}
+
+bool ClipboardDB::apply_updates(const std::vector<ItemUpdate>& updates) {
+    if (updates.empty()) return true;
+    if (!pool_) return false;
+
+    auto connection = pool_->write();
+    char* err_msg = nullptr;
+    if (sqlite3_exec(connection.db(), "BEGIN IMMEDIATE", nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::cerr << "❌ DB: Failed to begin update batch: " << (err_msg ? err_msg : "unknown") << std::endl;
+        sqlite3_free(err_msg);
+        return false;
+    }
+
+    bool ok = std::all_of(updates.begin(), updates.end(), [&connection](const ItemUpdate& update) {
+        return apply_update(connection, update);
+    });
+
+    // A failed batch is dropped as a whole; enrichment is best effort
+    if (sqlite3_exec(connection.db(), ok ? "COMMIT" : "ROLLBACK", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        std::cerr << "❌ DB: Failed to commit update batch: " << sqlite3_errmsg(connection.db()) << std::endl;
+        sqlite3_exec(connection.db(), "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    return ok;
+}
+
+void ClipboardDB::set_updates_committed_callback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(updates_committed_mutex_);
+    updates_committed_callback_ = std::move(callback);
+}
+
 bool ClipboardDB::delete_item(int64_t id) {
     const char* sql = "DELETE FROM clipboard_items WHERE id = ?";
     
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "❌ Error preparando DELETE: " << sqlite3_errmsg(db_) << std::endl;
+    auto connection = pool_->write();
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
+        std::cerr << "❌ Error preparando DELETE: " << sqlite3_errmsg(connection.db()) << std::endl;
         return false;
     }
     
@@ -518,22 +810,21 @@ bool ClipboardDB::delete_item(int64_t id) {
     int rc = sqlite3_step(stmt);
     
     if (rc != SQLITE_DONE) {
-        std::cerr << "❌ Error ejecutando DELETE: " << sqlite3_errmsg(db_) << std::endl;
-        sqlite3_finalize(stmt);
+        std::cerr << "❌ Error ejecutando DELETE: " << sqlite3_errmsg(connection.db()) << std::endl;
         return false;
     }
     
-    int changes = sqlite3_changes(db_);
+    int changes = sqlite3_changes(connection.db());
     std::cout << "🔧 BD: " << changes << " filas borradas" << std::endl;
     
-    sqlite3_finalize(stmt);
     return changes > 0;
 }
 
 bool ClipboardDB::delete_all() {
     const char* sql = "DELETE FROM clipboard_items";
+    auto connection = pool_->write();
     char* err_msg = nullptr;
-    int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &err_msg);
+    int rc = sqlite3_exec(connection.db(), sql, nullptr, nullptr, &err_msg);
     
     if (rc != SQLITE_OK) {
         sqlite3_free(err_msg);
@@ -551,7 +842,7 @@ std::vector<ClipboardItem> ClipboardDB::search_exact(const std::string& query, i
     }
 
     const char* sql = R"(
-        SELECT id, content, content_type, ocr_text, embedding, source_app, timestamp, is_password, is_encrypted, metadata, thumbnail, code_language
+        SELECT id, CASE WHEN content_type = 'Image' THEN NULL ELSE content END, content_type, ocr_text, embedding, source_app, timestamp, is_password, is_encrypted, metadata, thumbnail, code_language
         FROM clipboard_items
         WHERE (
             (content_type != 'Image' AND CAST(content AS TEXT) LIKE '%' || ? || '%' COLLATE NOCASE)
@@ -564,8 +855,10 @@ std::vector<ClipboardItem> ClipboardDB::search_exact(const std::string& query, i
         LIMIT ?
     )";
 
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto connection = pool_->read();
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
         return items;
     }
 
@@ -621,7 +914,6 @@ std::vector<ClipboardItem> ClipboardDB::search_exact(const std::string& query, i
         items.push_back(std::move(item));
     }
 
-    sqlite3_finalize(stmt);
     return items;
 }
 
@@ -629,15 +921,17 @@ std::vector<ClipboardItem> ClipboardDB::search_fts(const std::string& query, int
     std::vector<ClipboardItem> items;
     
     const char* sql = R"(
-        SELECT c.id, c.content, c.content_type, c.ocr_text, c.embedding, c.source_app, c.timestamp, c.is_password, c.is_encrypted, c.metadata, c.thumbnail, c.code_language
+        SELECT c.id, CASE WHEN c.content_type = 'Image' THEN NULL ELSE c.content END, c.content_type, c.ocr_text, c.embedding, c.source_app, c.timestamp, c.is_password, c.is_encrypted, c.metadata, c.thumbnail, c.code_language
         FROM clipboard_items c
         INNER JOIN clipboard_fts f ON c.id = f.rowid
         WHERE f MATCH ?
         LIMIT ?
     )";
     
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto connection = pool_->read();
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
         return items;
     }
     
@@ -690,7 +984,6 @@ std::vector<ClipboardItem> ClipboardDB::search_fts(const std::string& query, int
         items.push_back(std::move(item));
     }
     
-    sqlite3_finalize(stmt);
     return items;
 }
 
@@ -702,18 +995,20 @@ std::string ClipboardItem::get_text() const {
 
 std::vector<ClipboardItem> ClipboardDB::search_by_embedding(const std::vector<float>& query_embedding, int limit) {
     std::vector<ClipboardItem> results;
-    if (db_ == nullptr) return results;
+    if (!pool_) return results;
 
     const char* sql = R"(
-        SELECT id, embedding, content, content_type, ocr_text, source_app, timestamp, code_language
+        SELECT id, embedding, CASE WHEN content_type = 'Image' THEN NULL ELSE content END, content_type, ocr_text, source_app, timestamp, code_language
         FROM clipboard_items
         WHERE embedding IS NOT NULL
         ORDER BY timestamp DESC
         LIMIT 100
     )";
 
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto connection = pool_->read();
+    auto statement = connection.prepare(sql);
+    sqlite3_stmt* stmt = statement.get();
+    if (!stmt) {
         return results;
     }
 
@@ -779,7 +1074,6 @@ std::vector<ClipboardItem> ClipboardDB::search_by_embedding(const std::vector<fl
         scored.push_back({0.0, std::move(item)});
     }
 
-    sqlite3_finalize(stmt);
 
     if (scored.empty() || query_embedding.empty()) return results;
 
@@ -821,28 +1115,26 @@ std::vector<ClipboardItem> ClipboardDB::search_by_embedding(const std::vector<fl
     return results;
 }
 
-bool ClipboardDB::content_exists(const std::vector<uint8_t>& content) {
+bool ClipboardDB::content_exists(const std::vector<uint8_t>& content, const std::string& content_hash) {
     if (content.empty()) return false;
     
-    // First check: exact match in content field
-    const char* sql_content = "SELECT COUNT(*) FROM clipboard_items WHERE content = ?";
-    sqlite3_stmt* stmt;
+    // First check: exact match in content field. The hash index narrows it
+    // down to a row or two; comparing the content rules out collisions.
+    const char* sql_content = "SELECT 1 FROM clipboard_items WHERE content_hash = ? AND content = ? LIMIT 1";
+    auto connection = pool_->read();
+    auto content_statement = connection.prepare(sql_content);
+    sqlite3_stmt* stmt = content_statement.get();
     
-    if (sqlite3_prepare_v2(db_, sql_content, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "❌ DB: Failed to prepare content_exists query: " << sqlite3_errmsg(db_) << std::endl;
+    if (!stmt) {
+        std::cerr << "❌ DB: Failed to prepare content_exists query: " << sqlite3_errmsg(connection.db()) << std::endl;
         return false;
     }
     
-    sqlite3_bind_blob(stmt, 1, content.data(), content.size(), SQLITE_STATIC);
+    std::string hash = content_hash.empty() ? hash_hex(content.data(), content.size()) : content_hash;
+    sqlite3_bind_text(stmt, 1, hash.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 2, content.data(), content.size(), SQLITE_STATIC);
     
-    bool exists = false;
     if (sqlite3_step(stmt) == SQLITE_ROW) {
-        int count = sqlite3_column_int(stmt, 0);
-        exists = (count > 0);
-    }
-    sqlite3_finalize(stmt);
-    
-    if (exists) {
         std::cout << "🔍 Duplicate found: exact match in content" << std::endl;
         return true;
     }
@@ -850,36 +1142,28 @@ bool ClipboardDB::content_exists(const std::vector<uint8_t>& content) {
     // Second check: if content is text, also check against ocr_text field in images
     // This prevents copying OCR text as a separate item when it's already part of an image
     std::string text_content(content.begin(), content.end());
+    std::string ocr_hash = ocr_hash_of(text_content);
+    if (ocr_hash.empty()) return false;
     
-    // Trim whitespace for comparison
-    auto trim = [](const std::string& s) {
-        auto start = s.find_first_not_of(" \t\n\r");
-        auto end = s.find_last_not_of(" \t\n\r");
-        if (start == std::string::npos) return std::string();
-        return s.substr(start, end - start + 1);
-    };
-    
-    std::string trimmed = trim(text_content);
-    
-    const char* sql_ocr = "SELECT ocr_text FROM clipboard_items WHERE content_type = 'Image' AND ocr_text IS NOT NULL AND ocr_text != ''";
-    if (sqlite3_prepare_v2(db_, sql_ocr, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "❌ DB: Failed to prepare OCR check query: " << sqlite3_errmsg(db_) << std::endl;
+    const char* sql_ocr = R"(
+        SELECT 1 FROM clipboard_items
+        WHERE ocr_hash = ? AND content_type = 'Image' AND trim(ocr_text, ' ' || char(9, 10, 13)) = trim(?, ' ' || char(9, 10, 13))
+        LIMIT 1
+    )";
+    auto ocr_statement = connection.prepare(sql_ocr);
+    stmt = ocr_statement.get();
+    if (!stmt) {
+        std::cerr << "❌ DB: Failed to prepare OCR check query: " << sqlite3_errmsg(connection.db()) << std::endl;
         return false;
     }
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        const char* ocr = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        if (ocr) {
-            std::string ocr_text(ocr);
-            std::string trimmed_ocr = trim(ocr_text);
-            if (trimmed == trimmed_ocr) {
-                std::cout << "🔍 Duplicate found: matches OCR text of an existing image" << std::endl;
-                exists = true;
-                break;
-            }
-        }
+    sqlite3_bind_text(stmt, 1, ocr_hash.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, text_content.c_str(), text_content.size(), SQLITE_STATIC);
+    
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        std::cout << "🔍 Duplicate found: matches OCR text of an existing image" << std::endl;
+        return true;
     }
-    sqlite3_finalize(stmt);
     
-    return exists;
+    return false;
 }
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "connection_pool.h"
 #include <sqlite3.h>
+#include <functional>
 #include <string>
 #include <vector>
 #include <optional>
 #include <memory>
+#include <mutex>
 
 enum class ClipboardType {
     Text,
@@ -34,8 +37,51 @@ struct ClipboardItem {
     std::string get_text() const;
     std::string text_content;
     std::string content_type;
+    // 128-bit hash of content as 32 hex digits, the daemon's if it sent one;
+    // computed on insert when empty
+    std::string content_hash;
 };
 
+// Characters of text kept in ClipboardItemSummary::preview
+constexpr int kSummaryPreviewChars = 512;
+
+// Box stored thumbnails are fit into, the list view's image area
+constexpr int kThumbnailWidth = 400;
+constexpr int kThumbnailHeight = 200;
+
+// What a list row shows, read without the content, embedding and metadata
+// blobs; the full item is loaded on demand through ClipboardDB::get()
+struct ClipboardItemSummary {
+    int64_t id = 0;
+    ClipboardType type = ClipboardType::Text;
+    std::string content_type;
+    std::string source_app;
+    int64_t timestamp = 0;
+    std::string code_language;
+    // Start of the text, or of the OCR text for images, cut in SQL
+    std::string preview;
+    // Empty until one was generated, see ClipboardService::request_thumbnails()
+    std::vector<uint8_t> thumbnail;
+    
+    bool is_image() const { return type == ClipboardType::Image || content_type == "Image"; }
+};
+
+// Field-level change to a stored item; only the fields that are set are
+// written, so concurrent enrichment results never overwrite each other
+struct ItemUpdate {
+    int64_t id = 0;
+    std::optional<ClipboardType> type;
+    std::optional<std::string> ocr_text;
+    std::optional<std::string> code_language;
+    std::optional<std::vector<float>> embedding;
+    std::optional<std::vector<uint8_t>> thumbnail;
+    
+    // Takes over every field set in the newer update
+    void merge(ItemUpdate&& newer);
+};
+
+class UpdateQueue;
+
 class ClipboardDB {
 public:
     explicit ClipboardDB(const std::string& db_path);
@@ -46,23 +92,47 @@ public:
     // CRUD operations
     int64_t insert(const ClipboardItem& item);
     std::optional<ClipboardItem> get(int64_t id);
-    std::vector<ClipboardItem> get_recent(int limit = 20);
     bool update(const ClipboardItem& item);
+    
+    // List view projections, newest first or in the order of ids
+    std::vector<ClipboardItemSummary> get_recent_summaries(int limit = 20);
+    std::vector<ClipboardItemSummary> get_summaries(const std::vector<int64_t>& ids);
+    
+    // Write-behind: the update is merged with others pending for the item and
+    // written in a batched transaction a few milliseconds later
+    void queue_update(ItemUpdate update);
+    // Writes a batch of updates in one transaction, only the columns they set
+    bool apply_updates(const std::vector<ItemUpdate>& updates);
+    // Runs on the queue's thread after each batch was committed
+    void set_updates_committed_callback(std::function<void()> callback);
     bool delete_item(int64_t id);
     bool delete_all();
     
-    // Search
+    // Search; results carry no image content, load it through get()
     std::vector<ClipboardItem> search_exact(const std::string& query, int limit = 20);
     std::vector<ClipboardItem> search_fts(const std::string& query, int limit = 20);
     std::vector<ClipboardItem> search_by_embedding(const std::vector<float>& embedding, int limit = 20);
     
-    // Duplicate detection
-    bool content_exists(const std::vector<uint8_t>& content);
+    // Duplicate detection: the same content, or text matching an image's OCR
+    // text. Both are index lookups; content_hash may be passed if known.
+    bool content_exists(const std::vector<uint8_t>& content, const std::string& content_hash = "");
     
 private:
+    // Read-only connections serving get/search queries in parallel
+    static constexpr size_t kReaderConnections = 4;
+    
     std::string db_path_;
-    sqlite3* db_ = nullptr;
     
-    bool create_tables();
-    bool create_indexes();
+    // Writes go through the single writer connection, reads through the
+    // WAL readers, so the UI never waits for enrichment write-backs
+    std::unique_ptr<ConnectionPool> pool_;
+    
+    std::mutex updates_committed_mutex_;
+    std::function<void()> updates_committed_callback_;
+    
+    // Declared last so it is destroyed first, flushing what is still queued
+    std::unique_ptr<UpdateQueue> update_queue_;
+    
+    bool create_tables(sqlite3* db);
+    bool create_indexes(sqlite3* db);
 };
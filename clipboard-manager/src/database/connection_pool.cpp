@@ -0,0 +1,131 @@
+#include "connection_pool.h"
+#include <iostream>
+#include <utility>
+
+// How long a connection waits on a lock held by another process (the .NET
+// app shares the file) or by a checkpoint before giving up with SQLITE_BUSY
+static constexpr int kBusyTimeoutMs = 5000;
+
+ConnectionLease::ConnectionLease(ConnectionPool* pool, PooledConnection* connection, bool writer)
+    : pool_(pool), connection_(connection), writer_(writer) {}
+
+ConnectionLease::~ConnectionLease() {
+    release();
+}
+
+ConnectionLease::ConnectionLease(ConnectionLease&& other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr))
+    , connection_(std::exchange(other.connection_, nullptr))
+    , writer_(other.writer_) {}
+
+ConnectionLease& ConnectionLease::operator=(ConnectionLease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = std::exchange(other.pool_, nullptr);
+        connection_ = std::exchange(other.connection_, nullptr);
+        writer_ = other.writer_;
+    }
+    return *this;
+}
+
+void ConnectionLease::release() {
+    if (!connection_) return;
+    pool_->release(std::exchange(connection_, nullptr), writer_);
+}
+
+ConnectionPool::ConnectionPool(std::string db_path, size_t reader_count)
+    : db_path_(std::move(db_path)), reader_count_(reader_count) {}
+
+ConnectionPool::~ConnectionPool() {
+    for (auto& reader : readers_) {
+        close_connection(reader);
+    }
+    close_connection(writer_);
+}
+
+bool ConnectionPool::open_writer() {
+    return open_connection(writer_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+}
+
+bool ConnectionPool::open_readers() {
+    std::vector<PooledConnection> readers(reader_count_);
+    for (auto& reader : readers) {
+        if (!open_connection(reader, SQLITE_OPEN_READONLY)) {
+            for (auto& opened : readers) {
+                close_connection(opened);
+            }
+            return false;
+        }
+        
+        // Per-connection settings; the WAL journal mode lives in the file
+        sqlite3_exec(reader.db, "PRAGMA cache_size = -16000; PRAGMA temp_store = MEMORY;",
+                     nullptr, nullptr, nullptr);
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    readers_ = std::move(readers);
+    for (auto& reader : readers_) {
+        idle_readers_.push_back(&reader);
+    }
+    return true;
+}
+
+ConnectionLease ConnectionPool::write() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!writer_.db) return ConnectionLease();
+    
+    writer_free_.wait(lock, [this] { return !writer_leased_; });
+    writer_leased_ = true;
+    return ConnectionLease(this, &writer_, true);
+}
+
+ConnectionLease ConnectionPool::read() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (readers_.empty()) return ConnectionLease();
+    
+    reader_free_.wait(lock, [this] { return !idle_readers_.empty(); });
+    PooledConnection* reader = idle_readers_.back();
+    idle_readers_.pop_back();
+    return ConnectionLease(this, reader, false);
+}
+
+bool ConnectionPool::open_connection(PooledConnection& connection, int flags) {
+    // Each connection is only ever used by the thread holding its lease
+    int rc = sqlite3_open_v2(db_path_.c_str(), &connection.db, flags | SQLITE_OPEN_NOMUTEX, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to open database: " << sqlite3_errmsg(connection.db) << std::endl;
+        sqlite3_close(connection.db);
+        connection.db = nullptr;
+        return false;
+    }
+    
+    sqlite3_busy_timeout(connection.db, kBusyTimeoutMs);
+    connection.statements = std::make_unique<StatementCache>(connection.db);
+    return true;
+}
+
+void ConnectionPool::close_connection(PooledConnection& connection) {
+    // Statements first, sqlite3_close() refuses to close with any left
+    connection.statements.reset();
+    if (connection.db) {
+        sqlite3_close(connection.db);
+        connection.db = nullptr;
+    }
+}
+
+void ConnectionPool::release(PooledConnection* connection, bool writer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (writer) {
+            writer_leased_ = false;
+        } else {
+            idle_readers_.push_back(connection);
+        }
+    }
+    
+    if (writer) {
+        writer_free_.notify_one();
+    } else {
+        reader_free_.notify_one();
+    }
+}
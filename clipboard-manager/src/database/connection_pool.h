@@ -0,0 +1,86 @@
+#pragma once
+
+#include "statement_cache.h"
+#include <sqlite3.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One SQLite connection and the statements prepared on it
+struct PooledConnection {
+    sqlite3* db = nullptr;
+    std::unique_ptr<StatementCache> statements;
+};
+
+class ConnectionPool;
+
+// Exclusive use of a pooled connection; it goes back to the pool when the
+// lease is destroyed. Statements prepared through it must not outlive it.
+class ConnectionLease {
+public:
+    ConnectionLease() = default;
+    ~ConnectionLease();
+    
+    ConnectionLease(ConnectionLease&& other) noexcept;
+    ConnectionLease& operator=(ConnectionLease&& other) noexcept;
+    ConnectionLease(const ConnectionLease&) = delete;
+    ConnectionLease& operator=(const ConnectionLease&) = delete;
+    
+    sqlite3* db() const { return connection_->db; }
+    CachedStatement prepare(const std::string& sql) const { return connection_->statements->acquire(sql); }
+    explicit operator bool() const { return connection_ != nullptr; }
+    
+private:
+    friend class ConnectionPool;
+    
+    ConnectionLease(ConnectionPool* pool, PooledConnection* connection, bool writer);
+    void release();
+    
+    ConnectionPool* pool_ = nullptr;
+    PooledConnection* connection_ = nullptr;
+    bool writer_ = false;
+};
+
+// A single writer connection, leased to one caller at a time so writes are
+// serialized, and a fixed set of read-only connections. With the database in
+// WAL mode a reader sees the last committed state and never waits for a
+// write in progress, so UI queries keep running during background
+// write-backs.
+class ConnectionPool {
+public:
+    ConnectionPool(std::string db_path, size_t reader_count);
+    ~ConnectionPool();
+    
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+    
+    // The writer creates the database and sets it up; the readers can only
+    // be opened once it exists in WAL mode
+    bool open_writer();
+    bool open_readers();
+    
+    // Both block until the connection is free. Empty lease if not opened.
+    ConnectionLease write();
+    ConnectionLease read();
+    
+private:
+    friend class ConnectionLease;
+    
+    bool open_connection(PooledConnection& connection, int flags);
+    void close_connection(PooledConnection& connection);
+    void release(PooledConnection* connection, bool writer);
+    
+    const std::string db_path_;
+    const size_t reader_count_;
+    
+    PooledConnection writer_;
+    std::vector<PooledConnection> readers_;
+    
+    std::mutex mutex_;
+    std::condition_variable writer_free_;
+    std::condition_variable reader_free_;
+    bool writer_leased_ = false;
+    std::vector<PooledConnection*> idle_readers_;
+};
@@ -0,0 +1,74 @@
+#include "statement_cache.h"
+#include <utility>
+
+CachedStatement::CachedStatement(StatementCache* cache, std::vector<sqlite3_stmt*>* idle, sqlite3_stmt* stmt)
+    : cache_(cache), idle_(idle), stmt_(stmt) {}
+
+CachedStatement::~CachedStatement() {
+    release();
+}
+
+CachedStatement::CachedStatement(CachedStatement&& other) noexcept
+    : cache_(std::exchange(other.cache_, nullptr))
+    , idle_(std::exchange(other.idle_, nullptr))
+    , stmt_(std::exchange(other.stmt_, nullptr)) {}
+
+CachedStatement& CachedStatement::operator=(CachedStatement&& other) noexcept {
+    if (this != &other) {
+        release();
+        cache_ = std::exchange(other.cache_, nullptr);
+        idle_ = std::exchange(other.idle_, nullptr);
+        stmt_ = std::exchange(other.stmt_, nullptr);
+    }
+    return *this;
+}
+
+void CachedStatement::release() {
+    if (!stmt_) return;
+    
+    sqlite3_reset(stmt_);
+    sqlite3_clear_bindings(stmt_);
+    cache_->release(idle_, std::exchange(stmt_, nullptr));
+}
+
+StatementCache::StatementCache(sqlite3* db) : db_(db) {}
+
+StatementCache::~StatementCache() {
+    clear();
+}
+
+CachedStatement StatementCache::acquire(const std::string& sql) {
+    std::vector<sqlite3_stmt*>* idle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle = &idle_[sql];
+        if (!idle->empty()) {
+            sqlite3_stmt* stmt = idle->back();
+            idle->pop_back();
+            return CachedStatement(this, idle, stmt);
+        }
+    }
+    
+    // Prepared outside the lock; a statement in use elsewhere gets a sibling
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(db_, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return CachedStatement();
+    }
+    return CachedStatement(this, idle, stmt);
+}
+
+void StatementCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [sql, statements] : idle_) {
+        for (sqlite3_stmt* stmt : statements) {
+            sqlite3_finalize(stmt);
+        }
+        statements.clear();
+    }
+}
+
+void StatementCache::release(std::vector<sqlite3_stmt*>* idle, sqlite3_stmt* stmt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle->push_back(stmt);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <sqlite3.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class StatementCache;
+
+// A prepared statement checked out of a StatementCache. When the handle goes
+// out of scope the statement is reset, its bindings are cleared and it goes
+// back to the cache, so the next user starts from a clean statement and no
+// read transaction is left open.
+class CachedStatement {
+public:
+    CachedStatement() = default;
+    CachedStatement(StatementCache* cache, std::vector<sqlite3_stmt*>* idle, sqlite3_stmt* stmt);
+    ~CachedStatement();
+    
+    CachedStatement(CachedStatement&& other) noexcept;
+    CachedStatement& operator=(CachedStatement&& other) noexcept;
+    CachedStatement(const CachedStatement&) = delete;
+    CachedStatement& operator=(const CachedStatement&) = delete;
+    
+    sqlite3_stmt* get() const { return stmt_; }
+    explicit operator bool() const { return stmt_ != nullptr; }
+    
+private:
+    void release();
+    
+    StatementCache* cache_ = nullptr;
+    std::vector<sqlite3_stmt*>* idle_ = nullptr; // Where the statement goes back to
+    sqlite3_stmt* stmt_ = nullptr;
+};
+
+// Prepared statements of one connection keyed by their SQL text, so each
+// query is parsed and planned once instead of on every call. Every SQL keeps
+// a list of idle statements: concurrent callers each get their own, and the
+// statements outlive the calls until the cache is destroyed, which must
+// happen before the connection is closed.
+class StatementCache {
+public:
+    explicit StatementCache(sqlite3* db);
+    ~StatementCache();
+    
+    StatementCache(const StatementCache&) = delete;
+    StatementCache& operator=(const StatementCache&) = delete;
+    
+    // Empty handle if the SQL does not compile; sqlite3_errmsg() has the reason
+    CachedStatement acquire(const std::string& sql);
+    
+    // Finalizes the idle statements, e.g. before the schema changes
+    void clear();
+    
+private:
+    friend class CachedStatement;
+    
+    void release(std::vector<sqlite3_stmt*>* idle, sqlite3_stmt* stmt);
+    
+    sqlite3* db_;
+    std::mutex mutex_;
+    // Entries are never erased, handles point at their list
+    std::unordered_map<std::string, std::vector<sqlite3_stmt*>> idle_;
+};
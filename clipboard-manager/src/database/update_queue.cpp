@@ -0,0 +1,63 @@
+#include "update_queue.h"
+#include <utility>
+
+UpdateQueue::UpdateQueue(Writer writer)
+    : writer_(std::move(writer))
+    , thread_([this] { run(); }) {}
+
+UpdateQueue::~UpdateQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void UpdateQueue::push(ItemUpdate update) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    auto it = pending_index_.find(update.id);
+    if (it != pending_index_.end()) {
+        pending_[it->second].merge(std::move(update));
+        return;
+    }
+    
+    if (pending_.empty()) {
+        first_pending_ = std::chrono::steady_clock::now();
+    }
+    pending_index_[update.id] = pending_.size();
+    pending_.push_back(std::move(update));
+    
+    // The timer thread only needs waking to start a timer or a full batch
+    if (pending_.size() == 1 || pending_.size() >= kMaxUpdateBatch) {
+        cv_.notify_one();
+    }
+}
+
+void UpdateQueue::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    while (true) {
+        if (pending_.empty()) {
+            if (!running_) break;
+            cv_.wait(lock);
+            continue;
+        }
+        
+        // Everything still pending is written on shutdown
+        auto due = first_pending_ + kUpdateFlushDelay;
+        if (running_ && pending_.size() < kMaxUpdateBatch && std::chrono::steady_clock::now() < due) {
+            cv_.wait_until(lock, due);
+            continue;
+        }
+        
+        std::vector<ItemUpdate> batch = std::move(pending_);
+        pending_.clear();
+        pending_index_.clear();
+        
+        lock.unlock();
+        writer_(batch);
+        lock.lock();
+    }
+}
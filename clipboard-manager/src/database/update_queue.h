@@ -0,0 +1,46 @@
+#pragma once
+
+#include "clipboard_db.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Longest an update waits for others to share its transaction
+constexpr std::chrono::milliseconds kUpdateFlushDelay(20);
+
+// A batch is written right away once this many items have pending updates
+constexpr size_t kMaxUpdateBatch = 64;
+
+// Write-behind queue for field-level item updates. Updates for the same item
+// are merged while they wait, and each batch goes to the writer in one call,
+// so a burst of enrichment results costs one commit instead of one per field.
+class UpdateQueue {
+public:
+    using Writer = std::function<void(const std::vector<ItemUpdate>&)>;
+    
+    explicit UpdateQueue(Writer writer);
+    // Writes whatever is still pending
+    ~UpdateQueue();
+    
+    UpdateQueue(const UpdateQueue&) = delete;
+    UpdateQueue& operator=(const UpdateQueue&) = delete;
+    
+    void push(ItemUpdate update);
+    
+private:
+    void run();
+    
+    Writer writer_;
+    
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<ItemUpdate> pending_;
+    std::unordered_map<int64_t, size_t> pending_index_; // Item id -> pending_ slot
+    std::chrono::steady_clock::time_point first_pending_;
+    bool running_ = true;
+    std::thread thread_;
+};
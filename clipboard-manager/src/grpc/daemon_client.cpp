@@ -1,14 +1,139 @@
 #include "daemon_client.h"
+#include <algorithm>
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+// Requested chunk size for large payloads; stays well below gRPC's 4 MB limit
+constexpr uint32_t kStreamChunkSize = 1024 * 1024;
+
+// Items larger than this are skipped instead of being reassembled
+constexpr uint64_t kMaxAssembledSize = 512ull * 1024 * 1024;
+
+// Unary messages carry whole items, above gRPC's 4 MB default; matches the
+// daemon's limit
+constexpr int kMaxMessageSize = 512 * 1024 * 1024;
+
+// Payloads from this size on are received as a memfd on local sockets
+constexpr uint64_t kMemfdThreshold = 256 * 1024;
+
+// Smallest payload the daemon compresses for a remote client (it clamps to
+// this anyway). bench/compression_bench.cpp shows deflating costs about
+// 60 ms per MiB against under 1 ms to copy it over a unix socket or TCP
+// loopback, at every size, so the link decides and not the payload size.
+constexpr uint64_t kCompressionThreshold = 1024;
+
+// Durable consumer name: the daemon keeps what this client has not stored
+// yet in its journal, across restarts of either side
+constexpr const char* kClientId = "clipboard-manager";
+
+// Acknowledgements are local to the daemon; a lost one is covered by the next
+constexpr auto kAcknowledgeTimeout = std::chrono::seconds(2);
+
+// Upper bound for an on-demand format transfer from the selection owner
+constexpr auto kFetchFormatTimeout = std::chrono::seconds(10);
+
+// Taking the selection is local to the daemon; called from the UI thread
+constexpr auto kSetContentTimeout = std::chrono::seconds(2);
+
+std::string to_hex(const std::string& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (unsigned char byte : bytes) {
+        hex.push_back(digits[byte >> 4]);
+        hex.push_back(digits[byte & 0x0f]);
+    }
+    return hex;
+}
+
+// Asks the daemon's fd socket for the memfd behind a token. Returns -1 on failure.
+int receive_payload_fd(const std::string& socket_path, uint64_t token) {
+    sockaddr_un addr{};
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        return -1;
+    }
+
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = -1;
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        send(sock, &token, sizeof(token), MSG_NOSIGNAL) == sizeof(token)) {
+        uint64_t size = 0;
+        iovec iov = { .iov_base = &size, .iov_len = sizeof(size) };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) == sizeof(size) && size > 0) {
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+    }
+
+    close(sock);
+    return fd;
+}
+
+// True for TCP addresses that leave the machine; only there can compression
+// save more time on the wire than it costs
+bool is_remote_address(const std::string& address) {
+    if (address.rfind("unix:", 0) == 0 || address.rfind("unix-abstract:", 0) == 0) {
+        return false;
+    }
+    std::string host = address;
+    for (const std::string scheme : {"dns:///", "ipv4:", "ipv6:"}) {
+        if (host.rfind(scheme, 0) == 0) {
+            host = host.substr(scheme.size());
+            break;
+        }
+    }
+    if (host.rfind('[', 0) == 0) {
+        host = host.substr(1, host.find(']') - 1);
+    } else if (std::count(host.begin(), host.end(), ':') == 1) {
+        host = host.substr(0, host.find(':'));
+    }
+    return host != "localhost" && host != "::1" && host.rfind("127.", 0) != 0;
+}
+}
 
 DaemonClient::DaemonClient(const std::string& server_address)
     : server_address_(server_address)
     , running_(false)
+    , last_sequence_(0)
+    , stream_epoch_(0)
+    , memfd_failed_sequence_(0)
 {
-    auto channel = grpc::CreateChannel(server_address_, grpc::InsecureChannelCredentials());
+    grpc::ChannelArguments args;
+    args.SetMaxSendMessageSize(kMaxMessageSize);
+    args.SetMaxReceiveMessageSize(kMaxMessageSize);
+    auto channel = grpc::CreateCustomChannel(server_address_, grpc::InsecureChannelCredentials(), args);
     stub_ = clipboardmanager::ClipboardService::NewStub(channel);
+    
+    // The daemon serves memfds next to its unix socket
+    const std::string unix_prefix = "unix://";
+    if (server_address_.rfind(unix_prefix, 0) == 0) {
+        fd_socket_path_ = server_address_.substr(unix_prefix.size()) + ".fd";
+    }
 }
 
 void DaemonClient::set_callback(std::function<void(const ClipboardEvent&)> callback) {
@@ -22,49 +147,72 @@ void DaemonClient::start() {
         try {
             std::cout << "🔧 Attempting to connect to daemon at " << server_address_ << "..." << std::endl;
             grpc::ClientContext context;
-            clipboardmanager::Empty request;
+            clipboardmanager::StreamEventsRequest request;
+            request.set_chunk_size(kStreamChunkSize);
+            if (!fd_socket_path_.empty()) {
+                if (last_sequence_ >= memfd_failed_sequence_) {
+                    request.set_memfd_threshold(kMemfdThreshold);
+                }
+            } else if (is_remote_address(server_address_)) {
+                request.set_compression_threshold(kCompressionThreshold);
+            }
+            request.set_resume_after(last_sequence_);
+            request.set_resume_epoch(stream_epoch_);
+            request.set_client_id(kClientId);
             clipboardmanager::ClipboardEvent response;
             
             auto reader = stub_->StreamClipboardEvents(&context, request);
             
             std::cout << "🔗 Connected to daemon, waiting for clipboard events..." << std::endl;
             
+            // Large payloads arrive as a header event followed by chunks
+            clipboardmanager::ClipboardEvent assembling;
+            bool in_transfer = false;
+            bool memfd_failed = false;
+            
             while (reader->Read(&response)) {
-                if (callback_) {
-                    ClipboardEvent event;
-                    
-                    // Convert proto ContentType to string
-                    switch (response.content_type()) {
-                        case clipboardmanager::ContentType::TEXT:
-                            event.content_type = "text";
-                            event.text_content = std::string(response.data().begin(), response.data().end());
-                            break;
-                        case clipboardmanager::ContentType::IMAGE:
-                            event.content_type = "image";
-                            event.image_data = std::vector<uint8_t>(response.data().begin(), response.data().end());
-                            break;
-                        case clipboardmanager::ContentType::HTML:
-                            event.content_type = "html";
-                            event.text_content = std::string(response.data().begin(), response.data().end());
-                            break;
-                        case clipboardmanager::ContentType::FILE:
-                            event.content_type = "file";
-                            event.text_content = std::string(response.data().begin(), response.data().end());
-                            break;
-                        default:
-                            event.content_type = "unknown";
-                            break;
+                if (response.chunk()) {
+                    if (!in_transfer) {
+                        continue;
                     }
                     
-                    event.timestamp = response.timestamp();
+                    assembling.mutable_data()->append(response.data());
+                    if (assembling.data().size() >= assembling.total_size()) {
+                        in_transfer = false;
+                        dispatch_event(assembling, assembling.data());
+                        assembling.Clear();
+                    }
+                } else if (response.memfd_token() != 0) {
+                    if (!dispatch_memfd_event(response)) {
+                        // The cursor was not advanced, so reopening the stream
+                        // replays the event with its payload sent inline
+                        std::cerr << "⚠️  Failed to receive shared clipboard payload, "
+                                  << "resuming without memfd" << std::endl;
+                        memfd_failed_sequence_ = response.sequence();
+                        memfd_failed = true;
+                        context.TryCancel();
+                        break;
+                    }
+                } else if (response.total_size() > 0) {
+                    in_transfer = response.total_size() <= kMaxAssembledSize;
+                    if (!in_transfer) {
+                        std::cerr << "⚠️  Skipping oversized clipboard item ("
+                                  << response.total_size() << " bytes)" << std::endl;
+                        mark_delivered(response);
+                        continue;
+                    }
                     
-                    std::cout << "📋 Received clipboard event: " << event.content_type << std::endl;
-                    callback_(event);
+                    assembling = std::move(response);
+                    assembling.mutable_data()->reserve(assembling.total_size());
+                } else {
+                    dispatch_event(response, response.data());
                 }
             }
             
             auto status = reader->Finish();
-            if (!status.ok()) {
+            if (memfd_failed) {
+                continue;
+            } else if (!status.ok()) {
                 std::cerr << "⚠️  Daemon disconnected: " << status.error_message() 
                           << " (code: " << status.error_code() << "), retrying in 5s..." << std::endl;
                 std::this_thread::sleep_for(std::chrono::seconds(5));
@@ -79,6 +227,145 @@ void DaemonClient::start() {
     }
 }
 
+bool DaemonClient::dispatch_memfd_event(const clipboardmanager::ClipboardEvent& header) {
+    int fd = receive_payload_fd(fd_socket_path_, header.memfd_token());
+    if (fd < 0) {
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) != header.total_size()) {
+        close(fd);
+        return false;
+    }
+    
+    // The memfd is sealed, so the mapping can be read in place
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    
+    dispatch_event(header, std::string_view(static_cast<const char*>(mapped), st.st_size));
+    munmap(mapped, st.st_size);
+    return true;
+}
+
+void DaemonClient::mark_delivered(const clipboardmanager::ClipboardEvent& header) {
+    if (header.dropped() > 0) {
+        std::cerr << "⚠️  Daemon replay log overran, " << header.dropped()
+                  << " clipboard events were lost" << std::endl;
+    }
+    
+    if (header.epoch() != 0) {
+        // Sequences of another daemon run say nothing about this one
+        if (header.epoch() != stream_epoch_) {
+            memfd_failed_sequence_ = 0;
+        }
+        stream_epoch_ = header.epoch();
+        last_sequence_ = header.sequence();
+        acknowledge(stream_epoch_, last_sequence_);
+    }
+}
+
+void DaemonClient::acknowledge(uint64_t epoch, uint64_t sequence) {
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() + kAcknowledgeTimeout);
+    
+    clipboardmanager::AcknowledgeRequest request;
+    request.set_client_id(kClientId);
+    request.set_epoch(epoch);
+    request.set_sequence(sequence);
+    
+    clipboardmanager::Empty response;
+    grpc::Status status = stub_->AcknowledgeEvents(&context, request, &response);
+    if (!status.ok()) {
+        std::cerr << "⚠️  Failed to acknowledge clipboard event " << sequence << ": "
+                  << status.error_message() << std::endl;
+    }
+}
+
+void DaemonClient::dispatch_event(const clipboardmanager::ClipboardEvent& response, std::string_view payload) {
+    if (!callback_) {
+        mark_delivered(response);
+        return;
+    }
+    
+    ClipboardEvent event;
+    
+    // Convert proto ContentType to string
+    switch (response.content_type()) {
+        case clipboardmanager::ContentType::TEXT:
+            event.content_type = "text";
+            event.text_content = std::string(payload);
+            break;
+        case clipboardmanager::ContentType::IMAGE:
+            event.content_type = "image";
+            event.image_data = std::vector<uint8_t>(payload.begin(), payload.end());
+            break;
+        case clipboardmanager::ContentType::HTML:
+            event.content_type = "html";
+            event.text_content = std::string(payload);
+            break;
+        case clipboardmanager::ContentType::FILE:
+            event.content_type = "file";
+            event.text_content = std::string(payload);
+            break;
+        default:
+            event.content_type = "unknown";
+            break;
+    }
+    
+    event.timestamp = response.timestamp();
+    event.available_mime_types.assign(response.available_mime_types().begin(),
+                                      response.available_mime_types().end());
+    event.content_hash = to_hex(response.content_hash());
+    
+    std::cout << "📋 Received clipboard event: " << event.content_type << std::endl;
+    callback_(event);
+    
+    // Only advanced once handled, so a disconnect mid-event replays it
+    mark_delivered(response);
+}
+
 void DaemonClient::stop() {
     running_ = false;
 }
+
+std::optional<std::vector<uint8_t>> DaemonClient::fetch_format(const std::string& mime_type) {
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() + kFetchFormatTimeout);
+    
+    clipboardmanager::FormatRequest request;
+    request.set_mime_type(mime_type);
+    
+    clipboardmanager::ClipboardContent response;
+    grpc::Status status = stub_->GetClipboardFormat(&context, request, &response);
+    
+    if (!status.ok()) {
+        std::cerr << "Failed to fetch " << mime_type << ": " << status.error_message() << std::endl;
+        return std::nullopt;
+    }
+    
+    const std::string& data = response.data();
+    return std::vector<uint8_t>(data.begin(), data.end());
+}
+
+bool DaemonClient::set_clipboard_content(const std::vector<uint8_t>& data, const std::string& mime_type) {
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() + kSetContentTimeout);
+    
+    clipboardmanager::ClipboardContent request;
+    request.set_data(data.data(), data.size());
+    request.set_mime_type(mime_type);
+    
+    clipboardmanager::Empty response;
+    grpc::Status status = stub_->SetClipboardContent(&context, request, &response);
+    
+    if (!status.ok()) {
+        std::cerr << "Failed to set clipboard content: " << status.error_message() << std::endl;
+        return false;
+    }
+    
+    return true;
+}
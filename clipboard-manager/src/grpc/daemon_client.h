@@ -1,8 +1,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <vector>
 #include <grpcpp/grpcpp.h>
 #include "clipboard.grpc.pb.h"
 #include "../services/clipboard_service.h"
@@ -15,9 +18,33 @@ public:
     void start();
     void stop();
     
+    // Fetches another representation of the current clipboard selection, one
+    // of the last event's available_mime_types. Blocks until the owner answers.
+    std::optional<std::vector<uint8_t>> fetch_format(const std::string& mime_type);
+    
+    // Makes the daemon own the clipboard with this content
+    bool set_clipboard_content(const std::vector<uint8_t>& data, const std::string& mime_type);
+    
 private:
+    void dispatch_event(const clipboardmanager::ClipboardEvent& response, std::string_view payload);
+    void mark_delivered(const clipboardmanager::ClipboardEvent& header);
+    // Lets the daemon advance our journal cursor; events up to sequence are stored
+    void acknowledge(uint64_t epoch, uint64_t sequence);
+    bool dispatch_memfd_event(const clipboardmanager::ClipboardEvent& header);
+    
     std::string server_address_;
+    std::string fd_socket_path_;
     std::unique_ptr<clipboardmanager::ClipboardService::Stub> stub_;
     std::function<void(const ClipboardEvent&)> callback_;
     bool running_;
+    
+    // Resume cursor: last event fully handled, so a reconnect only replays
+    // what was missed. After a restart the daemon resumes from the cursor it
+    // keeps for this client instead
+    uint64_t last_sequence_;
+    uint64_t stream_epoch_;
+    
+    // Event whose memfd could not be fetched; the stream is reopened without
+    // memfd until it was received inline
+    uint64_t memfd_failed_sequence_;
 };
@@ -2,9 +2,13 @@
 #include "../ml/embedding_service.h"
 #include "../ml/language_detector.h"
 #include "../ml/ocr_service.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <regex>
 #include <thread>
@@ -14,6 +18,8 @@ bool is_url_like(const std::string& input);
 bool is_json_like(const std::string& input);
 std::string detect_code_language(const std::string& text, LanguageDetector* detector);
 std::string build_embedding_text(const ClipboardItem& item);
+std::vector<uint8_t> make_thumbnail(const std::vector<uint8_t>& image);
+bool copy_with_wl_copy(const std::vector<uint8_t>& content);
 }
 
 ClipboardService::ClipboardService(std::shared_ptr<ClipboardDB> db)
@@ -67,7 +73,8 @@ OCRService* ClipboardService::get_ocr_service() {
 }
 
 void ClipboardService::set_items_updated_callback(std::function<void()> callback) {
-    items_updated_callback_ = std::move(callback);
+    // Background results reach the database in batches; one refresh per batch
+    db_->set_updates_committed_callback(std::move(callback));
 }
 
 void ClipboardService::process_event(const ClipboardEvent& event) {
@@ -80,7 +87,8 @@ void ClipboardService::process_event(const ClipboardEvent& event) {
         content_to_check.assign(event.text_content.begin(), event.text_content.end());
     }
     
-    if (!content_to_check.empty() && db_->content_exists(content_to_check)) {
+    // The daemon hashed the same payload; an empty hash is computed locally
+    if (!content_to_check.empty() && db_->content_exists(content_to_check, event.content_hash)) {
         std::cout << "⏭️  Duplicate content ignored (already exists in database or as OCR text)" << std::endl;
         return;
     }
@@ -90,6 +98,7 @@ void ClipboardService::process_event(const ClipboardEvent& event) {
         std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch()).count();
     item.source_app = "";
+    item.content_hash = event.content_hash;
     
     if (!event.image_data.empty()) {
         // Image content
@@ -119,23 +128,18 @@ void ClipboardService::process_event(const ClipboardEvent& event) {
             std::string text = item.text_content;
             auto db = db_;
             auto lang_detector = language_detector;
-            auto items_updated = items_updated_callback_;
             
-            std::thread([id, text, db, lang_detector, items_updated]() {
+            std::thread([id, text, db, lang_detector]() {
                 try {
                     std::string language = detect_code_language(text, lang_detector);
                     if (!language.empty()) {
                         // ML detected code - update item
-                        auto fresh_item = db->get(id);
-                        if (fresh_item) {
-                            fresh_item->type = ClipboardType::Code;
-                            fresh_item->code_language = language;
-                            db->update(*fresh_item);
-                            std::cout << "✅ Language detected for item " << id << ": " << language << std::endl;
-                            if (items_updated) {
-                                items_updated();
-                            }
-                        }
+                        ItemUpdate update;
+                        update.id = id;
+                        update.type = ClipboardType::Code;
+                        update.code_language = language;
+                        db->queue_update(std::move(update));
+                        std::cout << "✅ Language detected for item " << id << ": " << language << std::endl;
                     }
                 } catch (const std::exception& e) {
                     std::cerr << "⚠️  Error detecting language: " << e.what() << std::endl;
@@ -147,10 +151,9 @@ void ClipboardService::process_event(const ClipboardEvent& event) {
         if (auto* embedding_service = get_embedding_service()) {
             auto db = db_;
             auto embedder = embedding_service;
-            auto items_updated = items_updated_callback_;
             ClipboardItem snapshot = item;
 
-            std::thread([id, snapshot, db, embedder, items_updated]() {
+            std::thread([id, snapshot, db, embedder]() {
                 try {
                     auto fresh_item = db->get(id);
                     if (!fresh_item) {
@@ -171,17 +174,42 @@ void ClipboardService::process_event(const ClipboardEvent& event) {
                         return;
                     }
 
-                    fresh_item->embedding = std::move(emb);
-                    db->update(*fresh_item);
-                    if (items_updated) {
-                        items_updated();
-                    }
+                    ItemUpdate update;
+                    update.id = id;
+                    update.embedding = std::move(emb);
+                    db->queue_update(std::move(update));
                 } catch (const std::exception& e) {
                     std::cerr << "⚠️  Error generating embedding: " << e.what() << std::endl;
                 }
             }).detach();
         }
 
+        // Thumbnail in BACKGROUND; until it is stored the list shows a placeholder
+        if (item.type == ClipboardType::Image) {
+            {
+                std::lock_guard<std::mutex> lock(thumbnails_mutex_);
+                thumbnails_requested_.insert(id);
+            }
+            auto db = db_;
+            std::vector<uint8_t> image = item.content;
+
+            std::thread([id, image = std::move(image), db]() {
+                try {
+                    auto thumbnail = make_thumbnail(image);
+                    if (thumbnail.empty()) {
+                        return;
+                    }
+
+                    ItemUpdate update;
+                    update.id = id;
+                    update.thumbnail = std::move(thumbnail);
+                    db->queue_update(std::move(update));
+                } catch (const std::exception& e) {
+                    std::cerr << "⚠️  Error generating thumbnail: " << e.what() << std::endl;
+                }
+            }).detach();
+        }
+
         // OCR for images in BACKGROUND (can be expensive)
         if (item.type == ClipboardType::Image) {
             auto* ocr_service = get_ocr_service();
@@ -192,9 +220,8 @@ void ClipboardService::process_event(const ClipboardEvent& event) {
                 auto ocr = ocr_service;
                 auto lang_detector = language_detector_bg;
                 auto embedder = embedding_service_bg;
-                auto items_updated = items_updated_callback_;
 
-                std::thread([id, db, ocr, lang_detector, embedder, items_updated]() {
+                std::thread([id, db, ocr, lang_detector, embedder]() {
                     try {
                         auto fresh_item = db->get(id);
                         if (!fresh_item || fresh_item->type != ClipboardType::Image) {
@@ -206,9 +233,13 @@ void ClipboardService::process_event(const ClipboardEvent& event) {
                             return;
                         }
 
+                        ItemUpdate update;
+                        update.id = id;
+                        update.ocr_text = extracted;
                         fresh_item->ocr_text = extracted;
                         std::string language = detect_code_language(extracted, lang_detector);
                         if (!language.empty()) {
+                            update.code_language = language;
                             fresh_item->code_language = language;
                         }
 
@@ -216,14 +247,11 @@ void ClipboardService::process_event(const ClipboardEvent& event) {
                             std::string embedding_text = build_embedding_text(*fresh_item);
                             auto emb = embedder->generate_embedding(embedding_text);
                             if (!emb.empty()) {
-                                fresh_item->embedding = std::move(emb);
+                                update.embedding = std::move(emb);
                             }
                         }
 
-                        db->update(*fresh_item);
-                        if (items_updated) {
-                            items_updated();
-                        }
+                        db->queue_update(std::move(update));
                     } catch (const std::exception& e) {
                         std::cerr << "⚠️  Error in background OCR: " << e.what() << std::endl;
                     }
@@ -363,6 +391,50 @@ std::string build_embedding_text(const ClipboardItem& item) {
 
     return text;
 }
+
+// Fits the image into kThumbnailWidth x kThumbnailHeight as PNG, keeping
+// transparency; images that already fit are stored as they are
+std::vector<uint8_t> make_thumbnail(const std::vector<uint8_t>& image) {
+    cv::Mat decoded = cv::imdecode(image, cv::IMREAD_UNCHANGED);
+    if (decoded.empty()) {
+        return {};
+    }
+
+    double scale = std::min(static_cast<double>(kThumbnailWidth) / decoded.cols,
+                            static_cast<double>(kThumbnailHeight) / decoded.rows);
+    if (scale >= 1.0) {
+        return image;
+    }
+
+    cv::Mat resized;
+    cv::resize(decoded, resized,
+               cv::Size(std::max(1, static_cast<int>(decoded.cols * scale)),
+                        std::max(1, static_cast<int>(decoded.rows * scale))),
+               0, 0, cv::INTER_AREA);
+
+    std::vector<uint8_t> thumbnail;
+    if (!cv::imencode(".png", resized, thumbnail)) {
+        return {};
+    }
+    return thumbnail;
+}
+
+// Fallback when the daemon cannot take the selection; wl-copy detects the
+// MIME type itself and keeps serving the content after we exit. Only tried
+// in a Wayland session, anywhere else it cannot own the clipboard.
+bool copy_with_wl_copy(const std::vector<uint8_t>& content) {
+    const char* wayland_display = std::getenv("WAYLAND_DISPLAY");
+    if (!wayland_display || !*wayland_display) {
+        return false;
+    }
+    
+    FILE* pipe = popen("wl-copy 2>/dev/null", "w");
+    if (!pipe) {
+        return false;
+    }
+    size_t written = fwrite(content.data(), 1, content.size(), pipe);
+    return pclose(pipe) == 0 && written == content.size();
+}
 }
 
 ClipboardType ClipboardService::classify_content(const std::string& text) {
@@ -399,13 +471,53 @@ std::optional<ClipboardItem> ClipboardService::get_item(int64_t id) {
     return db_->get(id);
 }
 
-std::vector<ClipboardItem> ClipboardService::get_recent_items(int limit) {
+std::vector<ClipboardItemSummary> ClipboardService::get_recent_summaries(int limit) {
     std::cout << "🔧 Service: Getting recent items..." << std::endl;
-    auto items = db_->get_recent(limit);
+    auto items = db_->get_recent_summaries(limit);
     std::cout << "✅ Service: Got " << items.size() << " items" << std::endl;
     return items;
 }
 
+void ClipboardService::request_thumbnails(const std::vector<ClipboardItemSummary>& items) {
+    std::vector<int64_t> missing;
+    {
+        std::lock_guard<std::mutex> lock(thumbnails_mutex_);
+        for (const auto& item : items) {
+            if (item.is_image() && item.thumbnail.empty() && thumbnails_requested_.insert(item.id).second) {
+                missing.push_back(item.id);
+            }
+        }
+    }
+    if (missing.empty()) {
+        return;
+    }
+    
+    // Items from before thumbnails existed; each image is loaded once here
+    auto db = db_;
+    std::thread([missing, db]() {
+        for (int64_t id : missing) {
+            try {
+                auto item = db->get(id);
+                if (!item) {
+                    continue;
+                }
+                
+                auto thumbnail = make_thumbnail(item->content);
+                if (thumbnail.empty()) {
+                    continue;
+                }
+                
+                ItemUpdate update;
+                update.id = id;
+                update.thumbnail = std::move(thumbnail);
+                db->queue_update(std::move(update));
+            } catch (const std::exception& e) {
+                std::cerr << "⚠️  Error generating thumbnail: " << e.what() << std::endl;
+            }
+        }
+    }).detach();
+}
+
 void ClipboardService::delete_item(int64_t id) {
     std::cout << "🔧 ClipboardService: Borrando item " << id << std::endl;
     bool success = db_->delete_item(id);
@@ -420,47 +532,30 @@ void ClipboardService::clear_all() {
     db_->delete_all();
 }
 
+void ClipboardService::set_clipboard_writer(
+    std::function<bool(const std::vector<uint8_t>&, const std::string&)> writer) {
+    clipboard_writer_ = writer;
+}
+
 void ClipboardService::copy_to_clipboard(const ClipboardItem& item) {
     try {
-        if (item.type == ClipboardType::Image) {
-            // For images, write to temp file and use wl-copy
-            std::string temp_file = "/tmp/clipboard_temp_" + std::to_string(item.id) + ".png";
-            FILE* f = fopen(temp_file.c_str(), "wb");
-            if (f) {
-                fwrite(item.content.data(), 1, item.content.size(), f);
-                fclose(f);
-                
-                std::string cmd = "wl-copy < " + temp_file + " 2>/dev/null";
-                int result = system(cmd.c_str());
-                
-                // Clean up temp file
-                unlink(temp_file.c_str());
-                
-                if (result == 0) {
-                    std::cout << "✅ Image copied to clipboard" << std::endl;
-                } else {
-                    std::cerr << "⚠️  Failed to copy image" << std::endl;
-                }
-            }
+        if (item.content.empty()) {
+            std::cerr << "⚠️  Empty clipboard content" << std::endl;
+            return;
+        }
+        
+        // The daemon serves the bytes from memory, no temp files or wl-copy
+        std::string mime_type = item.mime_type;
+        if (mime_type.empty()) {
+            mime_type = item.type == ClipboardType::Image ? "image/png" : "text/plain;charset=utf-8";
+        }
+        
+        if (clipboard_writer_ && clipboard_writer_(item.content, mime_type)) {
+            std::cout << "✅ Copied to clipboard (" << mime_type << ")" << std::endl;
+        } else if (copy_with_wl_copy(item.content)) {
+            std::cout << "✅ Copied to clipboard with wl-copy" << std::endl;
         } else {
-            // For text, use wl-copy directly
-            FILE* pipe = popen("wl-copy 2>/dev/null", "w");
-            if (pipe) {
-                std::string text;
-                if (!item.content.empty()) {
-                    text = std::string(item.content.begin(), item.content.end());
-                }
-                if (!text.empty()) {
-                    fwrite(text.data(), 1, text.size(), pipe);
-                    pclose(pipe);
-                    std::cout << "✅ Text copied to clipboard" << std::endl;
-                } else {
-                    pclose(pipe);
-                    std::cerr << "⚠️  Empty text content" << std::endl;
-                }
-            } else {
-                std::cerr << "⚠️  Failed to open wl-copy" << std::endl;
-            }
+            std::cerr << "⚠️  Failed to copy to clipboard" << std::endl;
         }
     } catch (const std::exception& e) {
         std::cerr << "❌ Error in copy_to_clipboard: " << e.what() << std::endl;
@@ -5,6 +5,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_set>
 
 class EmbeddingService;
 class LanguageDetector;
@@ -15,6 +16,10 @@ struct ClipboardEvent {
     std::string text_content;
     std::vector<uint8_t> image_data;
     int64_t timestamp;
+    // Formats the daemon can still fetch with DaemonClient::fetch_format
+    std::vector<std::string> available_mime_types;
+    // Daemon-computed 128-bit payload hash as 32 hex digits, empty if unknown
+    std::string content_hash;
 };
 
 class ClipboardService {
@@ -24,13 +29,21 @@ public:
     
     void process_event(const ClipboardEvent& event);
     std::optional<ClipboardItem> get_item(int64_t id);
-    std::vector<ClipboardItem> get_recent_items(int limit = 20);
+    std::vector<ClipboardItemSummary> get_recent_summaries(int limit = 20);
+    // Generates missing thumbnails of listed images in the background, once
+    // per item; the items updated callback fires when they are stored
+    void request_thumbnails(const std::vector<ClipboardItemSummary>& items);
     void delete_item(int64_t id);
     void clear_all();
     void copy_to_clipboard(const ClipboardItem& item);
 
+    // Called once background enrichment results were written
     void set_items_updated_callback(std::function<void()> callback);
     
+    // Hands content to whoever owns the system clipboard for us (the daemon);
+    // returns false if it could not be set
+    void set_clipboard_writer(std::function<bool(const std::vector<uint8_t>&, const std::string&)> writer);
+    
     std::shared_ptr<ClipboardDB> get_db() { return db_; }
     
 private:
@@ -45,7 +58,10 @@ private:
     std::unique_ptr<LanguageDetector> language_detector_;
     std::unique_ptr<OCRService> ocr_service_;
 
-    std::function<void()> items_updated_callback_;
+    std::function<bool(const std::vector<uint8_t>&, const std::string&)> clipboard_writer_;
+    
+    std::mutex thumbnails_mutex_;
+    std::unordered_set<int64_t> thumbnails_requested_;
     
     ClipboardType classify_content(const std::string& text);
     void process_image(ClipboardItem& item);
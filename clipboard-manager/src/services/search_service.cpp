@@ -108,14 +108,14 @@ EmbeddingService* SearchService::get_embedding_service() {
     return embedding_service_.get();
 }
 
-std::vector<ClipboardItem> SearchService::search(const std::string& query, int limit) {
+std::vector<ClipboardItemSummary> SearchService::search(const std::string& query, int limit) {
     if (query.empty()) {
-        return db_->get_recent(limit);
+        return db_->get_recent_summaries(limit);
     }
 
     auto expanded_queries = build_query_expansions(query);
     if (expanded_queries.empty()) {
-        return db_->get_recent(limit);
+        return db_->get_recent_summaries(limit);
     }
 
     std::vector<ClipboardItem> exact_accum;
@@ -137,7 +137,14 @@ std::vector<ClipboardItem> SearchService::search(const std::string& query, int l
 
     // Hybrid search with strict priority: EXACT > FTS > SEMANTIC
     auto exact_plus_fts = merge_results(exact_accum, fts_accum, limit * 3);
-    return merge_results(exact_plus_fts, semantic_accum, limit);
+    auto ranked = merge_results(exact_plus_fts, semantic_accum, limit);
+
+    std::vector<int64_t> ids;
+    ids.reserve(ranked.size());
+    for (const auto& item : ranked) {
+        ids.push_back(item.id);
+    }
+    return db_->get_summaries(ids);
 }
 
 std::vector<ClipboardItem> SearchService::exact_search(const std::string& query, int limit) {
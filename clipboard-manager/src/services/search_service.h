@@ -11,7 +11,8 @@ class SearchService {
 public:
     explicit SearchService(std::shared_ptr<ClipboardDB> db);
     
-    std::vector<ClipboardItem> search(const std::string& query, int limit = 20);
+    // Ranked matches as list view summaries
+    std::vector<ClipboardItemSummary> search(const std::string& query, int limit = 20);
     
 private:
     std::shared_ptr<ClipboardDB> db_;
@@ -89,7 +89,7 @@ static std::string apply_syntax_highlighting(const std::string& code, const std:
     return highlighted;
 }
 
-ClipboardItemWidget::ClipboardItemWidget(const ClipboardItem& item)
+ClipboardItemWidget::ClipboardItemWidget(const ClipboardItemSummary& item)
     : Gtk::Box(Gtk::Orientation::VERTICAL)
     , item_(item)
 {
@@ -100,7 +100,9 @@ ClipboardItemWidget::ClipboardItemWidget(const ClipboardItem& item)
     header_box_.set_spacing(10);
     
     // Type label with icon
-    bool is_image_content = (item.type == ClipboardType::Image) || (item.content_type == "Image");
+    bool is_image_content = item.is_image();
+    // For images the preview is the start of the OCR text
+    std::string ocr_preview_text = is_image_content ? item.preview : std::string();
     std::string type_icon;
     std::string type_text;
     if (is_image_content) {
@@ -125,11 +127,11 @@ ClipboardItemWidget::ClipboardItemWidget(const ClipboardItem& item)
     
     // Setup OCR notification badge (like iOS/Android notification dot)
     bool has_ocr_badge = false;
-    if (!item.ocr_text.empty()) {
+    if (!ocr_preview_text.empty()) {
         if (!item.code_language.empty()) {
             has_ocr_badge = true;
         } else {
-            std::string trimmed = item.ocr_text;
+            std::string trimmed = ocr_preview_text;
             trimmed.erase(0, trimmed.find_first_not_of(" \t\n\r"));
             trimmed.erase(trimmed.find_last_not_of(" \t\n\r") + 1);
             if (trimmed.length() >= 5) {
@@ -207,18 +209,18 @@ ClipboardItemWidget::ClipboardItemWidget(const ClipboardItem& item)
     content_box_.set_spacing(5);
     
     if (is_image_content) {
-        // Show image
-        if (!item.content.empty()) {
+        // Show thumbnail
+        if (!item.thumbnail.empty()) {
             try {
                 auto loader = Gdk::PixbufLoader::create();
-                loader->write(item.content.data(), item.content.size());
+                loader->write(item.thumbnail.data(), item.thumbnail.size());
                 loader->close();
                 auto pixbuf = loader->get_pixbuf();
                 
                 if (pixbuf && pixbuf->get_width() > 0 && pixbuf->get_height() > 0) {
                     // ALWAYS scale to standard size for consistency
-                    int target_width = 400;
-                    int target_height = 200;
+                    int target_width = kThumbnailWidth;
+                    int target_height = kThumbnailHeight;
                     
                     // Calculate scale to fit within bounds while maintaining aspect ratio
                     double scale = std::min(
@@ -252,20 +254,21 @@ ClipboardItemWidget::ClipboardItemWidget(const ClipboardItem& item)
                 content_label_.add_css_class("error-label");
                 content_box_.append(content_label_);
             } catch (...) {
-                content_label_.set_text("[Image: " + std::to_string(item.content.size()) + " bytes - unknown error]");
+                content_label_.set_text("[Image: " + std::to_string(item.thumbnail.size()) + " bytes - unknown error]");
                 content_label_.add_css_class("error-label");
                 content_box_.append(content_label_);
             }
         } else {
-            content_label_.set_text("[Empty image data]");
-            content_label_.add_css_class("error-label");
+            // Older items get their thumbnail generated in the background
+            content_label_.set_text("🖼️ Preparing preview...");
+            content_label_.add_css_class("metadata-label");
             content_box_.append(content_label_);
         }
         
         // Show OCR text preview
-        if (!item.ocr_text.empty()) {
+        if (!ocr_preview_text.empty()) {
             if (!item.code_language.empty()) {
-                std::string ocr_preview = truncate_preview(item.ocr_text, 160);
+                std::string ocr_preview = truncate_preview(ocr_preview_text, 160);
                 ocr_label_.set_text(ocr_preview);
                 ocr_label_.set_wrap(true);
                 ocr_label_.set_wrap_mode(Pango::WrapMode::WORD_CHAR);
@@ -276,7 +279,7 @@ ClipboardItemWidget::ClipboardItemWidget(const ClipboardItem& item)
                 ocr_label_.add_css_class("ocr-label");
                 content_box_.append(ocr_label_);
             } else {
-                std::string trimmed = trim_copy(item.ocr_text);
+                std::string trimmed = trim_copy(ocr_preview_text);
                 
                 if (trimmed.length() >= 5) {
                     std::string ocr_preview = truncate_preview(trimmed, 160);
@@ -294,11 +297,7 @@ ClipboardItemWidget::ClipboardItemWidget(const ClipboardItem& item)
         }
     } else {
         // Show text content
-        std::string display_text;
-        if (!item.content.empty()) {
-            display_text = std::string(item.content.begin(), item.content.end());
-        }
-        display_text = truncate_preview(display_text, 280);
+        std::string display_text = truncate_preview(item.preview, 280);
         
         // Check if URL
         bool is_url = item.type == ClipboardType::URL || 
@@ -362,9 +361,9 @@ ClipboardItemWidget::ClipboardItemWidget(const ClipboardItem& item)
     }
     
     // Copy OCR button - ONLY for images with meaningful OCR text
-    if (is_image_content && !item.ocr_text.empty()) {
+    if (is_image_content && !ocr_preview_text.empty()) {
         // Trim to check if it's actually empty (whitespace only)
-        std::string trimmed = item.ocr_text;
+        std::string trimmed = ocr_preview_text;
         trimmed.erase(0, trimmed.find_first_not_of(" \t\n\r"));
         trimmed.erase(trimmed.find_last_not_of(" \t\n\r") + 1);
         
@@ -412,34 +411,9 @@ void ClipboardItemWidget::on_delete() {
 }
 
 void ClipboardItemWidget::on_open_url() {
-    std::string text;
-    if (!item_.content.empty()) {
-        text = std::string(item_.content.begin(), item_.content.end());
-    }
-    
-    std::regex url_regex(R"(https?://[^\s]+)");
-    std::smatch match;
-    
-    if (std::regex_search(text, match, url_regex)) {
-        std::string url = match.str();
-        std::string cmd = "xdg-open '" + url + "' 2>/dev/null &";
-        system(cmd.c_str());
-    }
+    signal_open_url_.emit();
 }
 
 void ClipboardItemWidget::on_copy_ocr() {
-    if (!item_.ocr_text.empty()) {
-        FILE* pipe = popen("wl-copy 2>/dev/null", "w");
-        if (pipe) {
-            fwrite(item_.ocr_text.data(), 1, item_.ocr_text.size(), pipe);
-            int result = pclose(pipe);
-            if (result == 0) {
-                std::cout << "✅ OCR text copied to clipboard" << std::endl;
-            } else {
-                std::cerr << "⚠️  Failed to copy OCR text" << std::endl;
-            }
-        } else {
-            std::cerr << "⚠️  Failed to open wl-copy for OCR text" << std::endl;
-        }
-    }
+    signal_copy_ocr_.emit();
 }
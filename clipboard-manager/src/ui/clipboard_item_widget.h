@@ -5,11 +5,14 @@
 
 class ClipboardItemWidget : public Gtk::Box {
 public:
-    explicit ClipboardItemWidget(const ClipboardItem& item);
+    explicit ClipboardItemWidget(const ClipboardItemSummary& item);
     virtual ~ClipboardItemWidget() = default;
     
     sigc::signal<void()>& signal_clicked() { return signal_clicked_; }
     sigc::signal<void()>& signal_delete() { return signal_delete_; }
+    // The summary only has a preview of the text; the owner acts on the full item
+    sigc::signal<void()>& signal_open_url() { return signal_open_url_; }
+    sigc::signal<void()>& signal_copy_ocr() { return signal_copy_ocr_; }
     
 protected:
     void on_click();
@@ -18,7 +21,7 @@ protected:
     void on_copy_ocr();
     
 private:
-    ClipboardItem item_;
+    ClipboardItemSummary item_;
     
     // UI Components
     Gtk::Box header_box_{Gtk::Orientation::HORIZONTAL};
@@ -48,4 +51,6 @@ private:
     // Signals
     sigc::signal<void()> signal_clicked_;
     sigc::signal<void()> signal_delete_;
+    sigc::signal<void()> signal_open_url_;
+    sigc::signal<void()> signal_copy_ocr_;
 };
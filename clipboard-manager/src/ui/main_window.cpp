@@ -1,6 +1,9 @@
 #include "main_window.h"
 #include "clipboard_item_widget.h"
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <regex>
 
 MainWindow::MainWindow(std::shared_ptr<ClipboardService> service)
     : clipboard_service_(service)
@@ -366,6 +369,46 @@ void MainWindow::on_delete_clicked(int64_t item_id) {
     load_items();
 }
 
+void MainWindow::on_open_url_clicked(int64_t item_id) {
+    // The list only holds a preview, which may cut a long URL short
+    auto item_opt = clipboard_service_->get_item(item_id);
+    if (!item_opt || item_opt->content.empty()) {
+        return;
+    }
+    
+    std::string text(item_opt->content.begin(), item_opt->content.end());
+    
+    std::regex url_regex(R"(https?://[^\s]+)");
+    std::smatch match;
+    
+    if (std::regex_search(text, match, url_regex)) {
+        std::string url = match.str();
+        std::string cmd = "xdg-open '" + url + "' 2>/dev/null &";
+        system(cmd.c_str());
+    }
+}
+
+void MainWindow::on_copy_ocr_clicked(int64_t item_id) {
+    // The list only holds a preview of the OCR text
+    auto item_opt = clipboard_service_->get_item(item_id);
+    if (!item_opt || item_opt->ocr_text.empty()) {
+        return;
+    }
+    
+    FILE* pipe = popen("wl-copy 2>/dev/null", "w");
+    if (pipe) {
+        fwrite(item_opt->ocr_text.data(), 1, item_opt->ocr_text.size(), pipe);
+        int result = pclose(pipe);
+        if (result == 0) {
+            std::cout << "✅ OCR text copied to clipboard" << std::endl;
+        } else {
+            std::cerr << "⚠️  Failed to copy OCR text" << std::endl;
+        }
+    } else {
+        std::cerr << "⚠️  Failed to open wl-copy for OCR text" << std::endl;
+    }
+}
+
 void MainWindow::on_clear_all_clicked() {
     clipboard_service_->clear_all();
     load_items();
@@ -373,7 +416,7 @@ void MainWindow::on_clear_all_clicked() {
 
 void MainWindow::load_items() {
     if (current_search_.empty()) {
-        items_ = clipboard_service_->get_recent_items(20);
+        items_ = clipboard_service_->get_recent_summaries(20);
     } else {
         if (!search_service_) {
             try {
@@ -386,10 +429,11 @@ void MainWindow::load_items() {
         if (search_service_) {
             items_ = search_service_->search(current_search_, 20);
         } else {
-            items_ = clipboard_service_->get_recent_items(20);
+            items_ = clipboard_service_->get_recent_summaries(20);
         }
     }
     
+    clipboard_service_->request_thumbnails(items_);
     update_item_list();
     status_label_.set_text(std::to_string(items_.size()) + " items");
 }
@@ -412,6 +456,14 @@ void MainWindow::update_item_list() {
                 on_delete_clicked(id);
             });
             
+            widget->signal_open_url().connect([this, id = item.id]() {
+                on_open_url_clicked(id);
+            });
+            
+            widget->signal_copy_ocr().connect([this, id = item.id]() {
+                on_copy_ocr_clicked(id);
+            });
+            
             // Connect to widget's own click signal (widget will emit it)
             // Use id capture only; avoid capturing the widget pointer to prevent dangling pointer crashes
             widget->signal_clicked().connect([this, id = item.id]() {
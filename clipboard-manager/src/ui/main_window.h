@@ -19,6 +19,8 @@ protected:
     void on_search_activated();
     void on_item_clicked(int64_t item_id);
     void on_delete_clicked(int64_t item_id);
+    void on_open_url_clicked(int64_t item_id);
+    void on_copy_ocr_clicked(int64_t item_id);
     void on_clear_all_clicked();
     
     // UI update
@@ -43,7 +45,7 @@ private:
     Gtk::Label status_label_;
     
     // Data
-    std::vector<ClipboardItem> items_;
+    std::vector<ClipboardItemSummary> items_;
     std::string current_search_;
 
     std::atomic<bool> refresh_scheduled_{false};
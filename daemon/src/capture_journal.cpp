@@ -0,0 +1,552 @@
+#include "capture_journal.h"
+#include "metadata_codec.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace clipboard {
+
+namespace {
+
+constexpr char kSegmentMagic[8] = {'C', 'L', 'P', 'J', 'R', 'N', 'L', '2'};
+// Segments whose record checksums do not cover the payload
+constexpr char kLegacySegmentMagic[8] = {'C', 'L', 'P', 'J', 'R', 'N', 'L', '1'};
+constexpr uint32_t kRecordMagic = 0x4a524543; // "CERJ"
+
+// Segment: 32-byte header, then 8-byte aligned records until a zero magic
+struct SegmentHeader {
+    char magic[8];
+    uint64_t first_sequence;
+    uint64_t reserved[2];
+};
+
+// The magic is written last, so a record interrupted mid-append never looks
+// complete. That does not order the writeback of the mapped pages, so the
+// checksum covers the header fields, the metadata and the payload: a record
+// whose payload pages were lost in a power failure fails it.
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t metadata_size;
+    uint64_t payload_size;
+    uint64_t sequence;
+    uint64_t checksum;
+};
+
+static_assert(sizeof(SegmentHeader) == 32, "journal segment header layout");
+static_assert(sizeof(RecordHeader) == 32, "journal record header layout");
+
+// State file: epoch and format, then one fixed-size entry per consumer in
+// the order they were registered
+constexpr uint64_t kStateFormat = 0x3130525543504c43; // "CLPCUR01"
+constexpr off_t kConsumersOffset = 2 * sizeof(uint64_t);
+
+struct ConsumerSlot {
+    char id[kJournalMaxConsumerId + 1]; // NUL-padded
+    uint64_t sequence;
+};
+
+static_assert(sizeof(ConsumerSlot) == 64, "journal consumer slot layout");
+
+size_t AlignRecord(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+// body is the metadata, directly followed by the payload
+uint64_t RecordChecksum(const RecordHeader& header, const uint8_t* body, bool include_payload) {
+    ContentHasher hasher;
+    hasher.Update(reinterpret_cast<const uint8_t*>(&header.metadata_size), sizeof(header.metadata_size));
+    hasher.Update(reinterpret_cast<const uint8_t*>(&header.payload_size), sizeof(header.payload_size));
+    hasher.Update(reinterpret_cast<const uint8_t*>(&header.sequence), sizeof(header.sequence));
+    hasher.Update(body, header.metadata_size);
+    if (include_payload) {
+        hasher.Update(body + header.metadata_size, header.payload_size);
+    }
+    return hasher.Finish().low;
+}
+
+} // namespace
+
+CaptureJournal::CaptureJournal(std::string directory)
+    : directory_(std::move(directory))
+    , epoch_(0)
+    , last_sequence_(0)
+    , cursor_fd_(-1)
+{
+}
+
+CaptureJournal::~CaptureJournal() {
+    Close();
+}
+
+std::string CaptureJournal::DefaultDirectory() {
+    if (const char* directory = std::getenv("CLIPBOARD_JOURNAL_DIR")) {
+        return directory;
+    }
+    if (const char* state_home = std::getenv("XDG_STATE_HOME"); state_home && *state_home) {
+        return std::string(state_home) + "/clipboard-daemon/journal";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return std::string(home) + "/.local/state/clipboard-daemon/journal";
+    }
+    return "";
+}
+
+bool CaptureJournal::Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error) {
+        std::cerr << "Failed to create journal directory " << directory_ << ": "
+                  << error.message() << std::endl;
+        return false;
+    }
+    std::filesystem::permissions(directory_, std::filesystem::perms::owner_all,
+                                 std::filesystem::perm_options::replace, error);
+
+    if (!LoadState()) {
+        return false;
+    }
+
+    // Zero-padded names sort by first sequence
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("journal-", 0) == 0 && entry.path().extension() == ".seg") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        LoadSegment(paths[i], i + 1 == paths.size());
+    }
+
+    // Delivered cursors outlive pruned segments
+    for (const auto& [consumer, cursor] : consumers_) {
+        last_sequence_ = std::max(last_sequence_, cursor.sequence);
+    }
+
+    Prune();
+
+    size_t records = 0;
+    for (const auto& segment : segments_) {
+        records += segment.records.size();
+    }
+    std::cout << "Capture journal at " << directory_ << ": " << segments_.size()
+              << " segments, " << records << " events, last sequence " << last_sequence_
+              << ", " << consumers_.size() << " consumers" << std::endl;
+    return true;
+}
+
+void CaptureJournal::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    SealActiveSegment();
+    for (auto& segment : segments_) {
+        UnmapSegment(segment);
+    }
+    segments_.clear();
+    consumers_.clear();
+
+    if (cursor_fd_ >= 0) {
+        close(cursor_fd_);
+        cursor_fd_ = -1;
+    }
+}
+
+bool CaptureJournal::LoadState() {
+    std::string path = directory_ + "/state";
+    cursor_fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (cursor_fd_ < 0) {
+        std::cerr << "Failed to open journal state " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    uint64_t state[2] = {0, 0};
+    if (pread(cursor_fd_, state, sizeof(state), 0) == sizeof(state) && state[0] != 0) {
+        epoch_ = state[0];
+        if (state[1] == kStateFormat) {
+            ConsumerSlot slot;
+            for (off_t offset = kConsumersOffset;
+                 pread(cursor_fd_, &slot, sizeof(slot), offset) == sizeof(slot);
+                 offset += sizeof(slot)) {
+                slot.id[kJournalMaxConsumerId] = '\0';
+                consumers_[slot.id] = {slot.sequence, offset};
+            }
+            return true;
+        }
+
+        // A single cursor shared by all streams says nothing about what any
+        // one consumer has stored, so each drains the retained events again
+        std::cerr << "Journal state has no per-consumer cursors, resetting them" << std::endl;
+    } else {
+        // New journal: a fresh epoch so cursors from an older one are not reused
+        epoch_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    state[0] = epoch_;
+    state[1] = kStateFormat;
+    if (pwrite(cursor_fd_, state, sizeof(state), 0) != sizeof(state) ||
+        ftruncate(cursor_fd_, sizeof(state)) != 0) {
+        std::cerr << "Failed to write journal state: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CaptureJournal::LoadSegment(const std::string& path, bool is_last) {
+    Segment segment;
+    segment.path = path;
+    segment.fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (segment.fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(segment.fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+        close(segment.fd);
+        unlink(path.c_str());
+        return false;
+    }
+
+    segment.capacity = st.st_size;
+    segment.mapped_size = segment.capacity;
+    segment.last_append = std::chrono::system_clock::from_time_t(st.st_mtime);
+
+    void* mapped = mmap(nullptr, segment.capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+    if (mapped == MAP_FAILED) {
+        close(segment.fd);
+        return false;
+    }
+    segment.base = static_cast<uint8_t*>(mapped);
+
+    SegmentHeader header;
+    std::memcpy(&header, segment.base, sizeof(header));
+    if (std::memcmp(header.magic, kLegacySegmentMagic, sizeof(kLegacySegmentMagic)) == 0) {
+        segment.payload_checksums = false;
+    } else if (std::memcmp(header.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0) {
+        std::cerr << "Ignoring journal segment with bad header: " << path << std::endl;
+        UnmapSegment(segment);
+        return false;
+    }
+    segment.first_sequence = header.first_sequence;
+
+    // Scan up to the first record that is missing or fails its checksum
+    size_t offset = sizeof(SegmentHeader);
+    while (segment.capacity - offset >= sizeof(RecordHeader)) {
+        RecordHeader record;
+        std::memcpy(&record, segment.base + offset, sizeof(record));
+        if (record.magic != kRecordMagic) {
+            break;
+        }
+
+        size_t body = static_cast<size_t>(record.metadata_size) + record.payload_size;
+        if (record.payload_size > segment.capacity ||
+            segment.capacity - offset - sizeof(RecordHeader) < body ||
+            record.sequence <= last_sequence_ ||
+            RecordChecksum(record, segment.base + offset + sizeof(RecordHeader),
+                           segment.payload_checksums) != record.checksum) {
+            std::cerr << "Journal segment " << path << " ends in a damaged record at offset "
+                      << offset << std::endl;
+            break;
+        }
+
+        segment.records.push_back({record.sequence, offset});
+        last_sequence_ = record.sequence;
+        offset += AlignRecord(sizeof(RecordHeader) + body);
+    }
+    segment.used = std::min(offset, segment.capacity);
+
+    // A segment created right before a crash still reserves its sequence
+    if (segment.records.empty()) {
+        last_sequence_ = std::max(last_sequence_, segment.first_sequence - 1);
+        if (!is_last) {
+            UnmapSegment(segment);
+            unlink(path.c_str());
+            return false;
+        }
+    }
+
+    // Only the last segment is appended to
+    if (!is_last) {
+        close(segment.fd);
+        segment.fd = -1;
+    }
+
+    segments_.push_back(std::move(segment));
+    return true;
+}
+
+bool CaptureJournal::CreateSegment(uint64_t first_sequence, size_t min_capacity) {
+    char name[64];
+    snprintf(name, sizeof(name), "/journal-%020llu.seg", static_cast<unsigned long long>(first_sequence));
+
+    Segment segment;
+    segment.path = directory_ + name;
+    segment.capacity = std::max(kJournalSegmentSize, min_capacity);
+    segment.mapped_size = segment.capacity;
+    segment.first_sequence = first_sequence;
+    segment.used = sizeof(SegmentHeader);
+    segment.last_append = std::chrono::system_clock::now();
+
+    segment.fd = open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (segment.fd < 0) {
+        std::cerr << "Failed to create journal segment " << segment.path << ": "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Reserve the blocks up front: a full disk must fail here, not as SIGBUS
+    // on a write through the mapping
+    int error = posix_fallocate(segment.fd, 0, segment.capacity);
+    if (error != 0) {
+        std::cerr << "Failed to allocate journal segment: " << strerror(error) << std::endl;
+        close(segment.fd);
+        unlink(segment.path.c_str());
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, segment.capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Failed to map journal segment: " << strerror(errno) << std::endl;
+        close(segment.fd);
+        unlink(segment.path.c_str());
+        return false;
+    }
+    segment.base = static_cast<uint8_t*>(mapped);
+
+    SegmentHeader header{};
+    std::memcpy(header.magic, kSegmentMagic, sizeof(kSegmentMagic));
+    header.first_sequence = first_sequence;
+    std::memcpy(segment.base, &header, sizeof(header));
+
+    segments_.push_back(std::move(segment));
+    return true;
+}
+
+void CaptureJournal::SealActiveSegment() {
+    if (segments_.empty() || segments_.back().fd < 0) {
+        return;
+    }
+
+    // Give back the unused preallocation; the mapping is never read past used
+    Segment& segment = segments_.back();
+    if (ftruncate(segment.fd, segment.used) == 0) {
+        segment.capacity = segment.used;
+    }
+    close(segment.fd);
+    segment.fd = -1;
+}
+
+bool CaptureJournal::Append(uint64_t sequence, const ClipboardData& data) {
+    std::string metadata = EncodeClipboardMetadata(data);
+    size_t record_size = AlignRecord(sizeof(RecordHeader) + metadata.size() + data.data.size());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (cursor_fd_ < 0 || sequence <= last_sequence_) {
+        return false;
+    }
+
+    bool has_room = !segments_.empty() && segments_.back().fd >= 0 &&
+                    segments_.back().capacity - segments_.back().used >= record_size;
+    if (!has_room) {
+        SealActiveSegment();
+        if (!CreateSegment(sequence, sizeof(SegmentHeader) + record_size)) {
+            return false;
+        }
+        Prune();
+    }
+
+    Segment& segment = segments_.back();
+    uint8_t* record = segment.base + segment.used;
+
+    RecordHeader header{};
+    header.metadata_size = static_cast<uint32_t>(metadata.size());
+    header.payload_size = data.data.size();
+    header.sequence = sequence;
+
+    std::memcpy(record + sizeof(header), metadata.data(), metadata.size());
+    if (!data.data.empty()) {
+        std::memcpy(record + sizeof(header) + metadata.size(), data.data.data(), data.data.size());
+    }
+    header.checksum = RecordChecksum(header, record + sizeof(header), segment.payload_checksums);
+    std::memcpy(record, &header, sizeof(header));
+
+    // Commit point
+    std::memcpy(record, &kRecordMagic, sizeof(kRecordMagic));
+
+    segment.records.push_back({sequence, segment.used});
+    segment.used += record_size;
+    segment.last_append = std::chrono::system_clock::now();
+    last_sequence_ = sequence;
+    return true;
+}
+
+uint64_t CaptureJournal::RegisterConsumer(const std::string& consumer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const Consumer* cursor = FindOrAddConsumer(consumer);
+    return cursor ? cursor->sequence : 0;
+}
+
+void CaptureJournal::Acknowledge(const std::string& consumer, uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Consumer* cursor = FindOrAddConsumer(consumer);
+    if (!cursor || sequence <= cursor->sequence || sequence > last_sequence_) {
+        return;
+    }
+
+    cursor->sequence = sequence;
+    WriteCursor(consumer, *cursor);
+}
+
+CaptureJournal::Consumer* CaptureJournal::FindOrAddConsumer(const std::string& consumer) {
+    if (cursor_fd_ < 0 || consumer.empty() || consumer.size() > kJournalMaxConsumerId) {
+        return nullptr;
+    }
+
+    auto it = consumers_.find(consumer);
+    if (it == consumers_.end()) {
+        Consumer cursor;
+        cursor.slot = kConsumersOffset + consumers_.size() * sizeof(ConsumerSlot);
+        it = consumers_.emplace(consumer, cursor).first;
+        WriteCursor(consumer, cursor);
+    }
+    return &it->second;
+}
+
+void CaptureJournal::WriteCursor(const std::string& consumer, const Consumer& cursor) {
+    ConsumerSlot slot{};
+    std::memcpy(slot.id, consumer.data(), consumer.size());
+    slot.sequence = cursor.sequence;
+    if (pwrite(cursor_fd_, &slot, sizeof(slot), cursor.slot) != sizeof(slot)) {
+        std::cerr << "Failed to write journal cursor: " << strerror(errno) << std::endl;
+    }
+}
+
+uint64_t CaptureJournal::GetLastSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_sequence_;
+}
+
+std::vector<EventBroadcaster::Event> CaptureJournal::ReadAfter(uint64_t after, size_t max_events,
+                                                               size_t max_bytes) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<EventBroadcaster::Event> events;
+    size_t total_bytes = 0;
+    bool full = false;
+
+    for (const auto& segment : segments_) {
+        if (segment.records.empty() || segment.records.back().sequence <= after) {
+            continue;
+        }
+
+        auto it = std::upper_bound(segment.records.begin(), segment.records.end(), after,
+            [](uint64_t sequence, const RecordIndex& index) { return sequence < index.sequence; });
+
+        for (; it != segment.records.end() && events.size() < max_events; ++it) {
+            const uint8_t* record = segment.base + it->offset;
+            RecordHeader header;
+            std::memcpy(&header, record, sizeof(header));
+
+            if (!events.empty() && total_bytes + header.payload_size > max_bytes) {
+                full = true;
+                break;
+            }
+
+            // Checked again before replay: the file may have been damaged since Open()
+            const uint8_t* metadata = record + sizeof(header);
+            if (RecordChecksum(header, metadata, segment.payload_checksums) != header.checksum) {
+                std::cerr << "Skipping damaged journal event " << header.sequence << std::endl;
+                continue;
+            }
+
+            ClipboardData data;
+            if (!DecodeClipboardMetadata(metadata, header.metadata_size, data)) {
+                continue;
+            }
+
+            const uint8_t* payload = metadata + header.metadata_size;
+            data.data.assign(payload, payload + header.payload_size);
+            total_bytes += header.payload_size;
+
+            events.push_back({header.sequence, std::make_shared<const ClipboardData>(std::move(data)), {}});
+        }
+
+        if (full || events.size() >= max_events) {
+            break;
+        }
+    }
+
+    return events;
+}
+
+void CaptureJournal::Prune() {
+    uint64_t total_bytes = 0;
+    for (const auto& segment : segments_) {
+        total_bytes += segment.used;
+    }
+
+    // Delivered means acknowledged by every consumer; with none, nothing is
+    uint64_t delivered_sequence = 0;
+    if (!consumers_.empty()) {
+        delivered_sequence = UINT64_MAX;
+        for (const auto& [consumer, cursor] : consumers_) {
+            delivered_sequence = std::min(delivered_sequence, cursor.sequence);
+        }
+    }
+
+    auto now = std::chrono::system_clock::now();
+
+    // Oldest first, never the segment being appended to
+    while (segments_.size() > 1) {
+        const Segment& oldest = segments_.front();
+        bool delivered = oldest.records.empty() || oldest.records.back().sequence <= delivered_sequence;
+        bool over_budget = total_bytes > kJournalMaxBytes;
+        bool expired = now - oldest.last_append > kJournalMaxAge;
+
+        if (!delivered && !over_budget && !expired) {
+            break;
+        }
+
+        if (!delivered) {
+            std::cerr << "Journal dropping " << oldest.records.size()
+                      << " undelivered events (" << (over_budget ? "size" : "age") << " limit)" << std::endl;
+        }
+
+        total_bytes -= oldest.used;
+        RemoveSegment(0);
+    }
+}
+
+void CaptureJournal::RemoveSegment(size_t index) {
+    Segment& segment = segments_[index];
+    UnmapSegment(segment);
+    unlink(segment.path.c_str());
+    segments_.erase(segments_.begin() + index);
+}
+
+void CaptureJournal::UnmapSegment(Segment& segment) {
+    if (segment.base) {
+        munmap(segment.base, segment.mapped_size);
+        segment.base = nullptr;
+    }
+    if (segment.fd >= 0) {
+        close(segment.fd);
+        segment.fd = -1;
+    }
+}
+
+} // namespace clipboard
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "clipboard_monitor.h"
+#include "event_broadcaster.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace clipboard {
+
+// Journal limits: segments are rotated at this size (larger records get a
+// segment of their own), and the oldest segments are removed once the
+// journal exceeds the byte budget or age, delivered or not
+constexpr size_t kJournalSegmentSize = 32 * 1024 * 1024;
+constexpr uint64_t kJournalMaxBytes = 512ull * 1024 * 1024;
+constexpr std::chrono::hours kJournalMaxAge(24 * 7);
+
+// Longest consumer name a delivered cursor can be stored under
+constexpr size_t kJournalMaxConsumerId = 55;
+
+// Durable, append-only record of captured events.
+//
+// Events are appended to memory-mapped segment files named after their first
+// sequence number, so a capture is on disk (in the page cache) as soon as
+// Append() returns and survives a daemon crash. Each record carries a
+// checksum of its header, metadata and payload, checked on Open() and again
+// on every read: a record with a torn or lost page is never replayed.
+//
+// Sequence numbers continue across daemon runs and are qualified by a
+// persistent epoch. The journal also persists one delivered cursor per named
+// consumer, advanced only by that consumer's acknowledgements: a consumer
+// that connects without a cursor drains what was captured after its own,
+// and sealed segments are removed once every consumer acknowledged them.
+class CaptureJournal {
+public:
+    explicit CaptureJournal(std::string directory);
+    ~CaptureJournal();
+
+    bool Open();
+    void Close();
+
+    uint64_t GetEpoch() const { return epoch_; }
+    uint64_t GetLastSequence() const;
+
+    // Sequences must be increasing
+    bool Append(uint64_t sequence, const ClipboardData& data);
+
+    // The consumer's delivered cursor. A new consumer is registered at 0, so
+    // it drains every retained event, and keeps segments from being removed
+    // as delivered until it acknowledged them.
+    uint64_t RegisterConsumer(const std::string& consumer);
+
+    // Advances the consumer's cursor, registering it if needed; never moves
+    // backwards
+    void Acknowledge(const std::string& consumer, uint64_t sequence);
+
+    // Up to max_events journaled events after the given sequence, in order.
+    // Stops before the payloads would exceed max_bytes, but always returns
+    // the first event.
+    std::vector<EventBroadcaster::Event> ReadAfter(uint64_t after, size_t max_events,
+                                                   size_t max_bytes) const;
+
+    // $CLIPBOARD_JOURNAL_DIR if set (empty disables the journal), otherwise
+    // $XDG_STATE_HOME/clipboard-daemon/journal or ~/.local/state/...
+    static std::string DefaultDirectory();
+
+private:
+    struct RecordIndex {
+        uint64_t sequence;
+        size_t offset;
+    };
+
+    struct Consumer {
+        uint64_t sequence = 0;
+        off_t slot = 0; // Offset of its entry in the state file
+    };
+
+    struct Segment {
+        std::string path;
+        int fd = -1;
+        uint8_t* base = nullptr;
+        size_t mapped_size = 0;
+        size_t capacity = 0;
+        size_t used = 0;
+        uint64_t first_sequence = 0;
+        bool payload_checksums = true; // False for segments of the first format
+        std::chrono::system_clock::time_point last_append;
+        std::vector<RecordIndex> records;
+    };
+
+    bool LoadState();
+    bool LoadSegment(const std::string& path, bool is_last);
+    bool CreateSegment(uint64_t first_sequence, size_t min_capacity);
+    void SealActiveSegment();
+    void Prune();
+    void RemoveSegment(size_t index);
+    void UnmapSegment(Segment& segment);
+    Consumer* FindOrAddConsumer(const std::string& consumer);
+    void WriteCursor(const std::string& consumer, const Consumer& cursor);
+
+    const std::string directory_;
+    uint64_t epoch_;
+    uint64_t last_sequence_;
+    int cursor_fd_;
+
+    mutable std::mutex mutex_;
+    std::vector<Segment> segments_; // Oldest first; the last one is appended to
+    std::map<std::string, Consumer> consumers_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,172 @@
+#include "capture_trace.h"
+#include "metadata_codec.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace clipboard {
+
+namespace {
+
+constexpr char kTraceMagic[8] = {'C', 'L', 'P', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t kTraceVersion = 1;
+constexpr uint32_t kTraceRecordMagic = 0x43415254; // "TRAC"
+
+// Records larger than this are treated as corruption
+constexpr uint64_t kMaxTracePayload = 1ull << 30;
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+// Followed by the encoded metadata, then the payload
+struct TraceRecordHeader {
+    uint32_t magic;
+    uint32_t metadata_size;
+    uint64_t payload_size;
+    uint64_t offset_us;
+};
+
+static_assert(sizeof(TraceHeader) == 16, "trace header layout");
+static_assert(sizeof(TraceRecordHeader) == 24, "trace record header layout");
+
+struct FileCloser {
+    void operator()(FILE* file) const { std::fclose(file); }
+};
+
+} // namespace
+
+TraceRecorder::TraceRecorder(std::string path)
+    : path_(std::move(path))
+    , file_(nullptr)
+    , recorded_(0)
+{
+}
+
+TraceRecorder::~TraceRecorder() {
+    Close();
+}
+
+bool TraceRecorder::Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    file_ = std::fopen(path_.c_str(), "wbe");
+    if (!file_) {
+        std::cerr << "Failed to create trace " << path_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    TraceHeader header{};
+    std::memcpy(header.magic, kTraceMagic, sizeof(header.magic));
+    header.version = kTraceVersion;
+    if (std::fwrite(&header, sizeof(header), 1, file_) != 1 || std::fflush(file_) != 0) {
+        std::cerr << "Failed to write trace " << path_ << std::endl;
+        std::fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+
+    std::cout << "Recording clipboard trace to " << path_ << std::endl;
+    return true;
+}
+
+void TraceRecorder::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+        std::cout << "Trace " << path_ << " closed after " << recorded_ << " captures" << std::endl;
+    }
+}
+
+void TraceRecorder::Record(const ClipboardData& data) {
+    auto now = std::chrono::steady_clock::now();
+    std::string metadata = EncodeClipboardMetadata(data);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_) {
+        return;
+    }
+
+    if (recorded_ == 0) {
+        start_ = now;
+    }
+
+    TraceRecordHeader header{};
+    header.magic = kTraceRecordMagic;
+    header.metadata_size = static_cast<uint32_t>(metadata.size());
+    header.payload_size = data.data.size();
+    header.offset_us = std::chrono::duration_cast<std::chrono::microseconds>(now - start_).count();
+
+    bool written = std::fwrite(&header, sizeof(header), 1, file_) == 1 &&
+                   std::fwrite(metadata.data(), 1, metadata.size(), file_) == metadata.size() &&
+                   std::fwrite(data.data.data(), 1, data.data.size(), file_) == data.data.size() &&
+                   std::fflush(file_) == 0;
+
+    if (!written) {
+        // A partial record ends the trace; LoadTrace() drops it
+        std::cerr << "Failed to write trace record, recording stopped" << std::endl;
+        std::fclose(file_);
+        file_ = nullptr;
+        return;
+    }
+
+    recorded_++;
+}
+
+uint64_t TraceRecorder::GetRecordedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return recorded_;
+}
+
+bool LoadTrace(const std::string& path, std::vector<TraceEvent>& events) {
+    std::unique_ptr<FILE, FileCloser> file(std::fopen(path.c_str(), "rbe"));
+    if (!file) {
+        std::cerr << "Failed to open trace " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    TraceHeader header{};
+    if (std::fread(&header, sizeof(header), 1, file.get()) != 1 ||
+        std::memcmp(header.magic, kTraceMagic, sizeof(header.magic)) != 0 ||
+        header.version != kTraceVersion) {
+        std::cerr << path << " is not a clipboard trace" << std::endl;
+        return false;
+    }
+
+    events.clear();
+    std::vector<uint8_t> metadata;
+
+    while (true) {
+        TraceRecordHeader record{};
+        if (std::fread(&record, sizeof(record), 1, file.get()) != 1) {
+            break;
+        }
+
+        if (record.magic != kTraceRecordMagic || record.payload_size > kMaxTracePayload) {
+            std::cerr << "Corrupt record in trace " << path << ", stopping there" << std::endl;
+            break;
+        }
+
+        auto data = std::make_shared<ClipboardData>();
+        metadata.resize(record.metadata_size);
+        data->data.resize(record.payload_size);
+
+        if (std::fread(metadata.data(), 1, metadata.size(), file.get()) != metadata.size() ||
+            std::fread(data->data.data(), 1, data->data.size(), file.get()) != data->data.size() ||
+            !DecodeClipboardMetadata(metadata.data(), metadata.size(), *data)) {
+            std::cerr << "Truncated record in trace " << path << ", dropped" << std::endl;
+            break;
+        }
+
+        events.push_back({std::chrono::microseconds(record.offset_us), std::move(data)});
+    }
+
+    std::cout << "Loaded " << events.size() << " captures from trace " << path << std::endl;
+    return true;
+}
+
+} // namespace clipboard
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "clipboard_monitor.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace clipboard {
+
+// One recorded capture and when it happened, relative to the first one
+struct TraceEvent {
+    std::chrono::microseconds offset;
+    ClipboardDataPtr data;
+};
+
+// Writes monitor captures with their timing to a trace file that
+// ReplayMonitor can play back. Records are flushed as they are written, so
+// a trace cut short by a crash is readable up to its last complete capture.
+class TraceRecorder {
+public:
+    explicit TraceRecorder(std::string path);
+    ~TraceRecorder();
+
+    bool Open();
+    void Close();
+
+    // Safe to call from any thread
+    void Record(const ClipboardData& data);
+
+    uint64_t GetRecordedCount() const;
+
+private:
+    const std::string path_;
+    mutable std::mutex mutex_;
+    FILE* file_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t recorded_;
+};
+
+// Reads a whole trace into memory; a truncated last record is dropped.
+// Returns false if the file cannot be read or is not a trace.
+bool LoadTrace(const std::string& path, std::vector<TraceEvent>& events);
+
+} // namespace clipboard
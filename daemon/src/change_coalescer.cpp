@@ -0,0 +1,132 @@
+#include "change_coalescer.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace clipboard {
+
+ChangeCoalescer::ChangeCoalescer(std::chrono::milliseconds settle_window, Sink sink)
+    : settle_window_(std::max(settle_window, std::chrono::milliseconds(0)))
+    , sink_(std::move(sink))
+    , running_(true)
+{
+    if (settle_window_.count() > 0) {
+        thread_ = std::thread([this] { Run(); });
+    }
+}
+
+ChangeCoalescer::~ChangeCoalescer() {
+    Stop();
+}
+
+void ChangeCoalescer::Submit(const ClipboardDataPtr& data) {
+    if (!data) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.received++;
+        
+        if (settle_window_.count() > 0 && running_) {
+            auto now = std::chrono::steady_clock::now();
+            Pending& pending = pending_[static_cast<size_t>(data->selection)];
+            
+            if (pending.data) {
+                stats_.collapsed++;
+            } else {
+                pending.first_seen = now;
+            }
+            pending.data = data;
+            pending.last_seen = now;
+            
+            cv_.notify_one();
+            return;
+        }
+        
+        stats_.emitted++;
+    }
+    
+    delay_.Record(std::chrono::steady_clock::duration::zero());
+    sink_(data);
+}
+
+void ChangeCoalescer::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    cv_.notify_one();
+    
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    
+    Stats stats = GetStats();
+    std::cout << "Change coalescer stopped (received " << stats.received
+              << ", emitted " << stats.emitted
+              << ", collapsed " << stats.collapsed << ")" << std::endl;
+}
+
+ChangeCoalescer::Stats ChangeCoalescer::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.delay = delay_.GetSnapshot();
+    return stats;
+}
+
+std::chrono::steady_clock::time_point ChangeCoalescer::DueTime(const Pending& pending) const {
+    return std::min(pending.last_seen + settle_window_, pending.first_seen + kMaxCoalesceDelay);
+}
+
+void ChangeCoalescer::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        auto next_due = std::chrono::steady_clock::time_point::max();
+        std::vector<ClipboardDataPtr> due;
+        
+        // Everything still pending is forwarded on Stop()
+        for (auto& pending : pending_) {
+            if (!pending.data) {
+                continue;
+            }
+            
+            auto due_time = DueTime(pending);
+            if (due_time <= now || !running_) {
+                delay_.Record(now - pending.first_seen);
+                due.push_back(std::move(pending.data));
+                pending = Pending();
+            } else {
+                next_due = std::min(next_due, due_time);
+            }
+        }
+        
+        if (!due.empty()) {
+            stats_.emitted += due.size();
+            
+            lock.unlock();
+            for (const auto& data : due) {
+                sink_(data);
+            }
+            lock.lock();
+            continue;
+        }
+        
+        if (!running_) {
+            break;
+        }
+        
+        if (next_due == std::chrono::steady_clock::time_point::max()) {
+            cv_.wait(lock);
+        } else {
+            cv_.wait_until(lock, next_due);
+        }
+    }
+}
+
+} // namespace clipboard
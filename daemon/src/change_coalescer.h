@@ -0,0 +1,73 @@
+#pragma once
+
+#include "clipboard_monitor.h"
+#include "latency_histogram.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace clipboard {
+
+// Default quiet period before a change is forwarded; bursts from terminals
+// and password managers land within a few milliseconds of each other
+constexpr std::chrono::milliseconds kDefaultSettleWindow(50);
+
+// A selection that keeps changing is still forwarded after this long
+constexpr std::chrono::milliseconds kMaxCoalesceDelay(1000);
+
+// Debounce stage between IClipboardMonitor::OnClipboardChanged and the
+// service. Each selection keeps only its latest capture, which is forwarded
+// once no newer one arrived for the settle window. Captures replaced while
+// waiting are counted as collapsed. A window of zero forwards immediately.
+class ChangeCoalescer {
+public:
+    using Sink = std::function<void(const ClipboardDataPtr&)>;
+    
+    struct Stats {
+        uint64_t received = 0;
+        uint64_t emitted = 0;
+        uint64_t collapsed = 0;
+        
+        // Time from the first capture of a burst until it was forwarded
+        LatencyHistogram::Snapshot delay;
+    };
+    
+    ChangeCoalescer(std::chrono::milliseconds settle_window, Sink sink);
+    ~ChangeCoalescer();
+    
+    // Called from the monitor thread; never waits for the sink
+    void Submit(const ClipboardDataPtr& data);
+    
+    // Forwards whatever is still pending and stops the timer thread
+    void Stop();
+    
+    Stats GetStats() const;
+    std::chrono::milliseconds GetSettleWindow() const { return settle_window_; }
+
+private:
+    struct Pending {
+        ClipboardDataPtr data;
+        std::chrono::steady_clock::time_point first_seen;
+        std::chrono::steady_clock::time_point last_seen;
+    };
+    
+    void Run();
+    std::chrono::steady_clock::time_point DueTime(const Pending& pending) const;
+    
+    const std::chrono::milliseconds settle_window_;
+    Sink sink_;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::array<Pending, 2> pending_; // Indexed by Selection
+    Stats stats_;
+    LatencyHistogram delay_;
+    bool running_;
+    std::thread thread_;
+};
+
+} // namespace clipboard
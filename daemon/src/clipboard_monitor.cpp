@@ -1,4 +1,5 @@
 #include "clipboard_monitor.h"
+#include "replay_monitor.h"
 #include "x11_monitor.h"
 
 #ifdef HAVE_WAYLAND
@@ -10,7 +11,162 @@
 
 namespace clipboard {
 
+ContentType ContentTypeForMime(const std::string& mime_type) {
+    if (mime_type.find("text/html") == 0) {
+        return ContentType::HTML;
+    } else if (mime_type.find("text/uri-list") == 0) {
+        return ContentType::FILE;
+    } else if (mime_type.find("text/") == 0) {
+        return ContentType::TEXT;
+    } else if (mime_type.find("image/") == 0) {
+        return ContentType::IMAGE;
+    }
+    return ContentType::UNKNOWN;
+}
+
+bool IsMetadataMimeType(const std::string& mime_type) {
+    return mime_type == "SAVE_TARGETS" ||
+           mime_type == "TARGETS" ||
+           mime_type == "MULTIPLE" ||
+           mime_type == "TIMESTAMP" ||
+           mime_type.find("chromium/") == 0;
+}
+
+bool MatchesMimePattern(const std::string& mime_type, const std::string& pattern) {
+    if (!pattern.empty() && pattern.back() == '*') {
+        return mime_type.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1) == 0;
+    }
+    return mime_type == pattern;
+}
+
+std::vector<std::string> OfferedMimeTypes(const std::string& mime_type) {
+    std::vector<std::string> offered = {mime_type};
+    
+    // Plain text goes by several names across toolkits and X11 clients
+    if (ContentTypeForMime(mime_type) == ContentType::TEXT) {
+        for (const char* alias : {"text/plain;charset=utf-8", "text/plain",
+                                  "UTF8_STRING", "STRING", "TEXT"}) {
+            if (mime_type != alias) {
+                offered.push_back(alias);
+            }
+        }
+    }
+    
+    return offered;
+}
+
+ClipboardDataPtr IClipboardMonitor::GetCurrentContent() const {
+    std::lock_guard<std::mutex> lock(current_content_mutex_);
+    return current_content_;
+}
+
+void IClipboardMonitor::RequestFormat(
+    [[maybe_unused]] const std::string& mime_type,
+    FormatCallback callback)
+{
+    // Monitors without lazy format support only have the captured representation
+    callback(nullptr);
+}
+
+void IClipboardMonitor::SetSelection(
+    [[maybe_unused]] ClipboardDataPtr content,
+    OwnershipCallback callback)
+{
+    // Monitors that cannot own a selection leave it to the clients
+    callback(false);
+}
+
+void IClipboardMonitor::NotifyClipboardChanged(ClipboardData data) {
+    NotifyClipboardChanged(std::make_shared<const ClipboardData>(std::move(data)));
+}
+
+void IClipboardMonitor::NotifyClipboardChanged(ClipboardDataPtr snapshot) {
+    // Copying the same content again is not a new capture
+    if (!snapshot->content_hash.IsEmpty()) {
+        std::lock_guard<std::mutex> lock(current_content_mutex_);
+        ContentHash& last_hash = last_hashes_[static_cast<size_t>(snapshot->selection)];
+        if (snapshot->content_hash == last_hash) {
+            duplicates_++;
+            std::cout << "   ⏭️  Same content as before (" << snapshot->content_hash.ToHex()
+                      << "), ignoring" << std::endl;
+            return;
+        }
+        last_hash = snapshot->content_hash;
+    }
+    
+    captures_++;
+    capture_bytes_ += snapshot->data.size();
+    
+    if (snapshot->selection == Selection::CLIPBOARD) {
+        std::lock_guard<std::mutex> lock(current_content_mutex_);
+        current_content_ = snapshot;
+    }
+    
+    if (OnClipboardChanged) {
+        OnClipboardChanged(snapshot);
+    }
+}
+
+void IClipboardMonitor::RecordRead(
+    const std::string& mime_type,
+    size_t bytes,
+    std::chrono::steady_clock::duration elapsed,
+    bool succeeded)
+{
+    read_latency_.Record(elapsed);
+    
+    std::lock_guard<std::mutex> lock(read_stats_mutex_);
+    auto it = mime_reads_.find(mime_type);
+    if (it == mime_reads_.end()) {
+        it = mime_reads_.try_emplace(
+            mime_reads_.size() < kMaxTrackedMimeTypes ? mime_type : "other").first;
+    }
+    
+    MimeReadCounters& counters = it->second;
+    counters.reads++;
+    counters.bytes += bytes;
+    if (!succeeded) {
+        counters.failures++;
+    }
+    counters.latency.Record(elapsed);
+}
+
+CaptureStats IClipboardMonitor::GetCaptureStats() const {
+    CaptureStats stats;
+    stats.captures = captures_;
+    stats.capture_bytes = capture_bytes_;
+    stats.duplicates = duplicates_;
+    stats.read_latency = read_latency_.GetSnapshot();
+    
+    std::lock_guard<std::mutex> lock(read_stats_mutex_);
+    for (const auto& [mime_type, counters] : mime_reads_) {
+        MimeReadStats mime_stats;
+        mime_stats.mime_type = mime_type;
+        mime_stats.reads = counters.reads;
+        mime_stats.failures = counters.failures;
+        mime_stats.bytes = counters.bytes;
+        mime_stats.latency = counters.latency.GetSnapshot();
+        
+        stats.reads += counters.reads;
+        stats.read_failures += counters.failures;
+        stats.read_bytes += counters.bytes;
+        stats.mime_types.push_back(std::move(mime_stats));
+    }
+    
+    return stats;
+}
+
 std::unique_ptr<IClipboardMonitor> CreateClipboardMonitor() {
+    // Headless playback of a recorded trace or a synthetic workload
+    if (const char* replay = std::getenv("CLIPBOARD_REPLAY")) {
+        const char* speed = std::getenv("CLIPBOARD_REPLAY_SPEED");
+        const char* loop = std::getenv("CLIPBOARD_REPLAY_LOOP");
+        std::cout << "Using replay monitor" << std::endl;
+        return std::make_unique<ReplayMonitor>(replay,
+                                               speed ? std::atof(speed) : 1.0,
+                                               loop && std::string(loop) == "1");
+    }
+    
     // Detect session type
     const char* session_type = std::getenv("XDG_SESSION_TYPE");
     const char* wayland_display = std::getenv("WAYLAND_DISPLAY");
@@ -1,7 +1,14 @@
 #pragma once
 
+#include "content_hash.h"
+#include "latency_histogram.h"
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -15,6 +22,15 @@ enum class ContentType {
     FILE = 4
 };
 
+enum class Selection {
+    CLIPBOARD = 0,
+    PRIMARY = 1
+};
+
+// Quiet period after the last primary selection change before it is
+// transferred; a mouse drag changes it on every motion event
+constexpr std::chrono::milliseconds kPrimarySettleDelay(500);
+
 struct ClipboardData {
     std::vector<uint8_t> data;
     std::string mime_type;
@@ -22,6 +38,65 @@ struct ClipboardData {
     std::string source_app;
     std::string window_title;
     int64_t timestamp;
+    
+    // Every representation the source offered; only mime_type was transferred
+    std::vector<std::string> available_mime_types;
+    
+    Selection selection = Selection::CLIPBOARD;
+    
+    // Hash of data, computed while it was read from the source
+    ContentHash content_hash;
+};
+
+// Immutable, refcounted capture shared by the snapshot, the event ring and
+// in-flight RPCs without copying the payload
+using ClipboardDataPtr = std::shared_ptr<const ClipboardData>;
+
+// Completion for IClipboardMonitor::RequestFormat(), nullptr on failure
+using FormatCallback = std::function<void(ClipboardDataPtr)>;
+
+// Completion for IClipboardMonitor::SetSelection(), true once the selection
+// was taken over
+using OwnershipCallback = std::function<void(bool)>;
+
+ContentType ContentTypeForMime(const std::string& mime_type);
+
+// Formats the daemon offers content of the given MIME type as when it owns
+// the selection: the type itself plus the legacy names text is asked for by
+std::vector<std::string> OfferedMimeTypes(const std::string& mime_type);
+
+// Control targets that describe the selection rather than hold its content
+bool IsMetadataMimeType(const std::string& mime_type);
+
+// Exact match, or a prefix match for patterns with a trailing '*' ("image/*")
+bool MatchesMimePattern(const std::string& mime_type, const std::string& pattern);
+
+// Read stats are kept per MIME type up to this many types; later ones are
+// counted under "other"
+constexpr size_t kMaxTrackedMimeTypes = 32;
+
+// Reads of one MIME type from selection owners
+struct MimeReadStats {
+    std::string mime_type;
+    uint64_t reads = 0;
+    uint64_t failures = 0;
+    uint64_t bytes = 0;
+    LatencyHistogram::Snapshot latency;
+};
+
+struct CaptureStats {
+    // Changes passed on to OnClipboardChanged, and recopies of the same payload
+    uint64_t captures = 0;
+    uint64_t capture_bytes = 0;
+    uint64_t duplicates = 0;
+    
+    // Transfers from the selection owner, from request to last byte;
+    // failures include timeouts and refused conversions
+    uint64_t reads = 0;
+    uint64_t read_failures = 0;
+    uint64_t read_bytes = 0;
+    LatencyHistogram::Snapshot read_latency;
+    std::vector<MimeReadStats> mime_types;
 };
 
 // Interface for clipboard monitoring
@@ -34,11 +109,67 @@ public:
     virtual void Stop() = 0;
     virtual bool IsRunning() const = 0;
     
+    // Last captured clipboard content, or nullptr before the first capture.
+    // Primary selection captures are only delivered through OnClipboardChanged.
+    ClipboardDataPtr GetCurrentContent() const;
+    
+    // Primary selection capture is off until a subscriber asks for it
+    void SetPrimarySelectionEnabled(bool enabled) { primary_selection_enabled_ = enabled; }
+    bool IsPrimarySelectionEnabled() const { return primary_selection_enabled_; }
+    
+    // Fetches another representation of the current selection on demand.
+    // The callback runs exactly once, normally on the monitor thread; it gets
+    // nullptr if the format is not offered, the selection changed first or
+    // the monitor stopped.
+    virtual void RequestFormat(const std::string& mime_type, FormatCallback callback);
+    
+    // Makes the daemon the clipboard selection owner, serving content from
+    // memory in every format of its available_mime_types until another
+    // client takes the selection over. The callback runs exactly once,
+    // normally on the monitor thread. Taking the selection over is reported
+    // through OnClipboardChanged like any other change.
+    virtual void SetSelection(ClipboardDataPtr content, OwnershipCallback callback);
+    
     // Callback when clipboard changes
-    std::function<void(const ClipboardData&)> OnClipboardChanged;
+    std::function<void(const ClipboardDataPtr&)> OnClipboardChanged;
+    
+    CaptureStats GetCaptureStats() const;
+
+protected:
+    // Stores the capture as the current snapshot and fires OnClipboardChanged,
+    // unless it repeats the previous payload of the same selection
+    void NotifyClipboardChanged(ClipboardData data);
+    void NotifyClipboardChanged(ClipboardDataPtr data);
+    
+    // Accounts one finished or failed read of a selection owner's data
+    void RecordRead(const std::string& mime_type, size_t bytes,
+                    std::chrono::steady_clock::duration elapsed, bool succeeded);
+
+private:
+    struct MimeReadCounters {
+        uint64_t reads = 0;
+        uint64_t failures = 0;
+        uint64_t bytes = 0;
+        LatencyHistogram latency;
+    };
+    
+    mutable std::mutex current_content_mutex_;
+    ClipboardDataPtr current_content_;
+    std::array<ContentHash, 2> last_hashes_; // Indexed by Selection
+    std::atomic<bool> primary_selection_enabled_{false};
+    
+    std::atomic<uint64_t> captures_{0};
+    std::atomic<uint64_t> capture_bytes_{0};
+    std::atomic<uint64_t> duplicates_{0};
+    LatencyHistogram read_latency_;
+    
+    mutable std::mutex read_stats_mutex_;
+    std::map<std::string, MimeReadCounters> mime_reads_;
 };
 
-// Factory function
+// Factory function. CLIPBOARD_REPLAY selects the ReplayMonitor (with
+// CLIPBOARD_REPLAY_SPEED and CLIPBOARD_REPLAY_LOOP=1), otherwise the monitor
+// matching the session
 std::unique_ptr<IClipboardMonitor> CreateClipboardMonitor();
 
 } // namespace clipboard
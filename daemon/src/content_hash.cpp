@@ -0,0 +1,163 @@
+#include "content_hash.h"
+#include <algorithm>
+#include <cstring>
+
+namespace clipboard {
+
+static constexpr uint64_t kC1 = 0x87c37b91114253d5ULL;
+static constexpr uint64_t kC2 = 0x4cf5ad432745937fULL;
+
+static inline uint64_t Rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t Fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static inline uint64_t ReadBlock64(const uint8_t* p) {
+    // Payloads are little-endian blocks, as in the reference implementation
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+std::string ContentHash::ToBytes() const {
+    std::string bytes(16, '\0');
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = static_cast<char>(high >> (56 - 8 * i));
+        bytes[8 + i] = static_cast<char>(low >> (56 - 8 * i));
+    }
+    return bytes;
+}
+
+std::string ContentHash::ToHex() const {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string bytes = ToBytes();
+    std::string hex;
+    hex.reserve(32);
+    for (unsigned char byte : bytes) {
+        hex.push_back(kDigits[byte >> 4]);
+        hex.push_back(kDigits[byte & 0x0f]);
+    }
+    return hex;
+}
+
+ContentHasher::ContentHasher()
+    : h1_(0)
+    , h2_(0)
+    , tail_{}
+    , tail_length_(0)
+    , total_length_(0)
+{
+}
+
+void ContentHasher::ProcessBlock(const uint8_t* block) {
+    uint64_t k1 = ReadBlock64(block);
+    uint64_t k2 = ReadBlock64(block + 8);
+    
+    k1 *= kC1;
+    k1 = Rotl64(k1, 31);
+    k1 *= kC2;
+    h1_ ^= k1;
+    
+    h1_ = Rotl64(h1_, 27);
+    h1_ += h2_;
+    h1_ = h1_ * 5 + 0x52dce729;
+    
+    k2 *= kC2;
+    k2 = Rotl64(k2, 33);
+    k2 *= kC1;
+    h2_ ^= k2;
+    
+    h2_ = Rotl64(h2_, 31);
+    h2_ += h1_;
+    h2_ = h2_ * 5 + 0x38495ab5;
+}
+
+void ContentHasher::Update(const uint8_t* data, size_t length) {
+    total_length_ += length;
+    
+    // Complete a block left over from the previous call first
+    if (tail_length_ > 0) {
+        size_t take = std::min(length, sizeof(tail_) - tail_length_);
+        std::memcpy(tail_ + tail_length_, data, take);
+        tail_length_ += take;
+        data += take;
+        length -= take;
+        
+        if (tail_length_ < sizeof(tail_)) {
+            return;
+        }
+        ProcessBlock(tail_);
+        tail_length_ = 0;
+    }
+    
+    while (length >= sizeof(tail_)) {
+        ProcessBlock(data);
+        data += sizeof(tail_);
+        length -= sizeof(tail_);
+    }
+    
+    if (length > 0) {
+        std::memcpy(tail_, data, length);
+        tail_length_ = length;
+    }
+}
+
+ContentHash ContentHasher::Finish() const {
+    uint64_t h1 = h1_;
+    uint64_t h2 = h2_;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    
+    for (size_t i = tail_length_; i > 8; i--) {
+        k2 ^= static_cast<uint64_t>(tail_[i - 1]) << (8 * (i - 9));
+    }
+    if (tail_length_ > 8) {
+        k2 *= kC2;
+        k2 = Rotl64(k2, 33);
+        k2 *= kC1;
+        h2 ^= k2;
+    }
+    
+    for (size_t i = std::min<size_t>(tail_length_, 8); i > 0; i--) {
+        k1 ^= static_cast<uint64_t>(tail_[i - 1]) << (8 * (i - 1));
+    }
+    if (tail_length_ > 0) {
+        k1 *= kC1;
+        k1 = Rotl64(k1, 31);
+        k1 *= kC2;
+        h1 ^= k1;
+    }
+    
+    h1 ^= total_length_;
+    h2 ^= total_length_;
+    
+    h1 += h2;
+    h2 += h1;
+    
+    h1 = Fmix64(h1);
+    h2 = Fmix64(h2);
+    
+    h1 += h2;
+    h2 += h1;
+    
+    // Reference output order is h1 then h2
+    return ContentHash{h1, h2};
+}
+
+ContentHash ContentHasher::Hash(const std::vector<uint8_t>& data) {
+    ContentHasher hasher;
+    hasher.Update(data.data(), data.size());
+    return hasher.Finish();
+}
+
+} // namespace clipboard
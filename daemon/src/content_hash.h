@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace clipboard {
+
+// 128-bit payload fingerprint, zero until computed
+struct ContentHash {
+    uint64_t high = 0;
+    uint64_t low = 0;
+    
+    bool IsEmpty() const { return high == 0 && low == 0; }
+    bool operator==(const ContentHash& other) const = default;
+    
+    // 16 bytes, big-endian (high word first)
+    std::string ToBytes() const;
+    std::string ToHex() const;
+};
+
+// Incremental MurmurHash3 x64_128 (seed 0), fed as payload bytes arrive so
+// hashing does not need a second pass over the data
+class ContentHasher {
+public:
+    ContentHasher();
+    
+    void Update(const uint8_t* data, size_t length);
+    ContentHash Finish() const;
+    
+    static ContentHash Hash(const std::vector<uint8_t>& data);
+
+private:
+    void ProcessBlock(const uint8_t* block);
+    
+    uint64_t h1_;
+    uint64_t h2_;
+    uint8_t tail_[16];
+    size_t tail_length_;
+    uint64_t total_length_;
+};
+
+} // namespace clipboard
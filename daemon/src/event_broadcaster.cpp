@@ -0,0 +1,166 @@
+#include "event_broadcaster.h"
+#include <algorithm>
+
+namespace clipboard {
+
+EventBroadcaster::EventBroadcaster(size_t max_events, size_t max_bytes, uint64_t first_sequence)
+    : max_bytes_(max_bytes)
+    , ring_(std::max<size_t>(max_events, 1))
+    , tail_sequence_(std::max<uint64_t>(first_sequence, 1))
+    , head_sequence_(tail_sequence_)
+    , retained_bytes_(0)
+    , next_subscriber_id_(1)
+    , shutdown_(false)
+{
+}
+
+uint64_t EventBroadcaster::Publish(ClipboardDataPtr event) {
+    if (!event) {
+        return 0;
+    }
+
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        size_t size = event->data.size();
+
+        // Make room: one free slot and enough byte budget. An event bigger than
+        // the whole budget is still kept on its own so it can be delivered.
+        while (head_sequence_ - tail_sequence_ >= ring_.size() ||
+               (tail_sequence_ < head_sequence_ && retained_bytes_ + size > max_bytes_)) {
+            EvictOldest();
+        }
+
+        sequence = head_sequence_++;
+        Slot& slot = ring_[sequence % ring_.size()];
+        slot.sequence = sequence;
+        slot.data = std::move(event);
+        slot.published_at = std::chrono::steady_clock::now();
+        retained_bytes_ += size;
+    }
+
+    NotifySubscribers();
+    return sequence;
+}
+
+EventBroadcaster::SubscriberId EventBroadcaster::Subscribe(Notifier notifier, uint64_t resume_after) {
+    SubscriberId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = next_subscriber_id_++;
+        // A cursor from the future can only be stale; deliver new events
+        subscribers_[id].next_sequence = resume_after == 0
+            ? tail_sequence_
+            : std::min(resume_after + 1, head_sequence_);
+    }
+
+    std::lock_guard<std::mutex> lock(notify_mutex_);
+    notifiers_[id] = std::move(notifier);
+    return id;
+}
+
+void EventBroadcaster::Unsubscribe(SubscriberId id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers_.erase(id);
+    }
+
+    // Waits for an in-progress notification to finish
+    std::lock_guard<std::mutex> lock(notify_mutex_);
+    notifiers_.erase(id);
+}
+
+std::vector<EventBroadcaster::Event> EventBroadcaster::ReadPending(SubscriberId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = subscribers_.find(id);
+    if (it == subscribers_.end()) {
+        return {};
+    }
+
+    return CollectPending(it->second);
+}
+
+uint64_t EventBroadcaster::GetDroppedCount(SubscriberId id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscribers_.find(id);
+    return it != subscribers_.end() ? it->second.dropped : 0;
+}
+
+uint64_t EventBroadcaster::GetNextSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return head_sequence_;
+}
+
+EventBroadcaster::Stats EventBroadcaster::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Stats stats;
+    stats.next_sequence = head_sequence_;
+    stats.retained_events = head_sequence_ - tail_sequence_;
+    stats.retained_bytes = retained_bytes_;
+    stats.capacity = ring_.size();
+    stats.max_bytes = max_bytes_;
+
+    stats.subscribers.reserve(subscribers_.size());
+    for (const auto& [id, subscriber] : subscribers_) {
+        uint64_t next = std::max(subscriber.next_sequence, tail_sequence_);
+        stats.subscribers.push_back({id, head_sequence_ - next,
+                                     subscriber.dropped + (next - subscriber.next_sequence)});
+    }
+
+    return stats;
+}
+
+void EventBroadcaster::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    NotifySubscribers();
+}
+
+bool EventBroadcaster::IsShutdown() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return shutdown_;
+}
+
+void EventBroadcaster::EvictOldest() {
+    Slot& slot = ring_[tail_sequence_ % ring_.size()];
+    if (slot.data) {
+        retained_bytes_ -= slot.data->data.size();
+        slot.data.reset();
+    }
+    tail_sequence_++;
+}
+
+void EventBroadcaster::NotifySubscribers() {
+    std::lock_guard<std::mutex> lock(notify_mutex_);
+    for (auto& [id, notifier] : notifiers_) {
+        if (notifier) {
+            notifier();
+        }
+    }
+}
+
+std::vector<EventBroadcaster::Event> EventBroadcaster::CollectPending(Subscriber& subscriber) {
+    // Events overwritten before this subscriber read them count as drops
+    if (subscriber.next_sequence < tail_sequence_) {
+        subscriber.dropped += tail_sequence_ - subscriber.next_sequence;
+        subscriber.next_sequence = tail_sequence_;
+    }
+
+    std::vector<Event> pending;
+    pending.reserve(head_sequence_ - subscriber.next_sequence);
+
+    while (subscriber.next_sequence < head_sequence_) {
+        const Slot& slot = ring_[subscriber.next_sequence % ring_.size()];
+        pending.push_back({slot.sequence, slot.data, slot.published_at});
+        subscriber.next_sequence++;
+    }
+
+    return pending;
+}
+
+} // namespace clipboard
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "clipboard_monitor.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace clipboard {
+
+// Fan-out ring buffer for clipboard events.
+//
+// Every published event is kept in a fixed-size ring bounded by both a slot
+// count and a byte budget. Each subscriber owns a read cursor into the ring,
+// so all subscribers see every event independently. A subscriber that falls
+// behind the oldest retained event skips ahead and the gap is added to its
+// drop counter; the publisher never blocks on slow readers.
+//
+// Subscribers are push-driven: the notifier passed to Subscribe() is invoked
+// after every Publish() and the subscriber drains its backlog with
+// ReadPending(), so no thread has to sit waiting for events.
+//
+// Sequence numbers start at first_sequence and increase by one per published
+// event, so the ring doubles as a replay log for clients that reconnect.
+class EventBroadcaster {
+public:
+    using SubscriberId = uint64_t;
+    using Notifier = std::function<void()>;
+    
+    struct Event {
+        uint64_t sequence;
+        ClipboardDataPtr data;
+        std::chrono::steady_clock::time_point published_at;
+    };
+    
+    struct SubscriberStats {
+        SubscriberId id;
+        uint64_t lag; // Retained events not read yet
+        uint64_t dropped;
+    };
+    
+    struct Stats {
+        uint64_t next_sequence = 0;
+        uint64_t retained_events = 0;
+        size_t retained_bytes = 0;
+        size_t capacity = 0;
+        size_t max_bytes = 0;
+        std::vector<SubscriberStats> subscribers;
+    };
+
+    EventBroadcaster(size_t max_events, size_t max_bytes, uint64_t first_sequence = 1);
+
+    // Stores the event and wakes waiting subscribers. Returns its sequence number.
+    uint64_t Publish(ClipboardDataPtr event);
+
+    // New subscribers start at the oldest retained event so that copies made
+    // while no client was connected are still delivered, or right after
+    // resume_after when it is set. Events between resume_after and the oldest
+    // retained one count as dropped. The notifier is also invoked on Shutdown().
+    SubscriberId Subscribe(Notifier notifier, uint64_t resume_after = 0);
+
+    // Once this returns the subscriber's notifier is not running and will not
+    // be invoked again.
+    void Unsubscribe(SubscriberId id);
+
+    // Returns the events the subscriber has not seen yet, in order. Never blocks.
+    std::vector<Event> ReadPending(SubscriberId id);
+
+    uint64_t GetDroppedCount(SubscriberId id) const;
+
+    // Sequence number the next Publish() will assign
+    uint64_t GetNextSequence() const;
+    
+    // Ring occupancy and every subscriber's backlog. Events evicted before a
+    // subscriber read them already count as dropped here.
+    Stats GetStats() const;
+
+    void Shutdown();
+    bool IsShutdown() const;
+
+private:
+    struct Slot {
+        uint64_t sequence = 0;
+        ClipboardDataPtr data;
+        std::chrono::steady_clock::time_point published_at;
+    };
+
+    struct Subscriber {
+        uint64_t next_sequence = 0;
+        uint64_t dropped = 0;
+    };
+
+    void EvictOldest();
+    void NotifySubscribers();
+    std::vector<Event> CollectPending(Subscriber& subscriber);
+
+    const size_t max_bytes_;
+    std::vector<Slot> ring_;
+
+    // Sequence range [tail_sequence_, head_sequence_) is retained in the ring
+    uint64_t tail_sequence_;
+    uint64_t head_sequence_;
+    size_t retained_bytes_;
+
+    std::unordered_map<SubscriberId, Subscriber> subscribers_;
+    SubscriberId next_subscriber_id_;
+    bool shutdown_;
+
+    mutable std::mutex mutex_;
+
+    // Guarded by notify_mutex_ only; never held together with mutex_ so that
+    // notifiers may call back into ReadPending().
+    std::unordered_map<SubscriberId, Notifier> notifiers_;
+    std::mutex notify_mutex_;
+};
+
+} // namespace clipboard
@@ -1,101 +1,754 @@
 #include "grpc_server.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <iostream>
+#include <mutex>
 
 namespace clipboard {
 
-ClipboardServiceImpl::ClipboardServiceImpl(IClipboardMonitor* monitor)
-    : monitor_(monitor)
-{
+// Formats whose payload is already compressed; deflating them again only
+// costs CPU
+static bool IsCompressedMimeType(const std::string& mime_type) {
+    static const std::vector<std::string> kCompressedPatterns = {
+        "image/png", "image/jpeg", "image/gif", "image/webp", "image/avif",
+        "image/heic", "video/*", "audio/*", "application/zip", "application/gzip",
+        "application/x-xz", "application/x-bzip2", "application/zstd", "application/pdf"
+    };
+    
+    return std::any_of(kCompressedPatterns.begin(), kCompressedPatterns.end(),
+                       [&mime_type](const std::string& pattern) {
+                           return MatchesMimePattern(mime_type, pattern);
+                       });
 }
 
-grpc::Status ClipboardServiceImpl::StreamClipboardEvents(
-    grpc::ServerContext* context,
-    [[maybe_unused]] const clipboardmanager::Empty* request,
-    grpc::ServerWriter<clipboardmanager::ClipboardEvent>* writer)
-{
-    std::cout << "Client connected for clipboard events stream" << std::endl;
+bool StreamFilter::Matches(const ClipboardData& data) const {
+    if (data.selection == Selection::PRIMARY && !include_primary) {
+        return false;
+    }
     
-    while (!context->IsCancelled()) {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
+    if (!content_types.empty() &&
+        std::find(content_types.begin(), content_types.end(), data.content_type) == content_types.end()) {
+        return false;
+    }
+    
+    if (!mime_patterns.empty() &&
+        std::none_of(mime_patterns.begin(), mime_patterns.end(),
+                     [&data](const std::string& pattern) {
+                         return MatchesMimePattern(data.mime_type, pattern);
+                     })) {
+        return false;
+    }
+    
+    return true;
+}
+
+bool StreamFilter::IncludesPayload(const ClipboardData& data) const {
+    return !metadata_only && (max_payload_bytes == 0 || data.data.size() <= max_payload_bytes);
+}
+
+// Writes broadcaster events to one client. Woken by the broadcaster on every
+// publish; at most one write is in flight and the next one is started from
+// OnWriteDone, so the stream never waits on a timer.
+//
+// With chunking enabled, payloads above chunk_size are written as a header
+// event followed by chunk events sliced straight from the shared snapshot, so
+// only one chunk is ever serialized at a time. Payloads at or above
+// memfd_threshold skip serialization entirely and are handed over as a
+// sealed memfd; chunking is the fallback if that fails.
+//
+// Events are skipped or sent without their payload according to the
+// stream's filter; primary selection events only go to clients that opted in.
+// Payload messages of at least compression_threshold bytes are compressed
+// with the algorithm negotiated for the call, all others are sent as is.
+//
+// Every header or inline event carries its sequence number and, after a
+// replay log overrun, how many events this stream lost before it.
+//
+// With replay, the stream first drains journaled events after its resume
+// cursor in batches and only subscribes to the broadcaster once it caught
+// up; events seen in both are sent once. Writes never move a delivered
+// cursor: clients acknowledge what they stored through AcknowledgeEvents.
+// Completed writes of events from the ring record the time since they were
+// published.
+class ClipboardServiceImpl::EventStreamReactor
+    : public grpc::ServerWriteReactor<clipboardmanager::ClipboardEvent> {
+public:
+    EventStreamReactor(ClipboardServiceImpl* service,
+                       size_t chunk_size,
+                       size_t memfd_threshold,
+                       size_t compression_threshold,
+                       StreamFilter filter,
+                       uint64_t resume_after,
+                       bool replay)
+        : service_(service)
+        , broadcaster_(&service->broadcaster_)
+        , memfd_transport_(service->memfd_transport_)
+        , journal_(service->journal_)
+        , subscriber_(0)
+        , chunk_size_(chunk_size)
+        , memfd_threshold_(memfd_threshold)
+        , compression_threshold_(compression_threshold)
+        , filter_(std::move(filter))
+        , replaying_(journal_ != nullptr && replay)
+        , last_sequence_(resume_after)
+        , chunked_sequence_(0)
+        , ack_sequence_(0)
+        , reported_dropped_(0)
+        , replay_dropped_(0)
+        , chunk_offset_(0)
+        , write_in_flight_(false)
+        , finished_(false)
+    {
+        if (filter_.include_primary) {
+            service_->AddPrimarySubscriber();
+        }
+        std::cout << "Client connected for clipboard events stream (resuming after "
+                  << resume_after << (replaying_ ? ", from journal" : "") << ")" << std::endl;
+        if (!replaying_) {
+            Subscribe();
+        }
+        WriteNext();
+    }
+    
+    void OnWriteDone(bool ok) override {
+        if (!ok) {
+            std::cout << "Client disconnected (subscriber " << subscriber_ << ")" << std::endl;
+            FinishOnce(grpc::Status::OK);
+            return;
+        }
         
-        // Wait for events or timeout
-        queue_cv_.wait_for(lock, std::chrono::seconds(1), [this] {
-            return !event_queue_.empty();
-        });
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            write_in_flight_ = false;
+            if (ack_sequence_ != 0) {
+                service_->events_written_++;
+                // Journal replays were never published in this run
+                if (ack_published_at_ != std::chrono::steady_clock::time_point()) {
+                    service_->publish_to_write_.Record(
+                        std::chrono::steady_clock::now() - ack_published_at_);
+                }
+            }
+            ack_sequence_ = 0;
+        }
+        WriteNext();
+    }
+    
+    void OnCancel() override {
+        FinishOnce(grpc::Status::CANCELLED);
+    }
+    
+    void OnDone() override {
+        std::cout << "Stream ended (subscriber " << subscriber_ << ", dropped "
+                  << broadcaster_->GetDroppedCount(subscriber_) + replay_dropped_
+                  << " events)" << std::endl;
+        broadcaster_->Unsubscribe(subscriber_);
+        if (filter_.include_primary) {
+            service_->RemovePrimarySubscriber();
+        }
+        delete this;
+    }
+
+private:
+    // Must not be called with mutex_ held: Publish() holds the broadcaster's
+    // notify lock while it runs our notifier, which takes mutex_
+    void Subscribe() {
+        uint64_t resume_after;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            resume_after = last_sequence_;
+        }
+        
+        auto id = broadcaster_->Subscribe([this] { WriteNext(); }, resume_after);
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscriber_ = id;
+    }
+    
+    void WriteNext() {
+        bool caught_up = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            caught_up = WriteNextLocked();
+        }
         
-        // Process all queued events
-        while (!event_queue_.empty()) {
-            auto data = event_queue_.front();
-            event_queue_.pop();
+        if (caught_up) {
+            Subscribe();
+            WriteNext();
+        }
+    }
+    
+    // Returns true once the journal replay is exhausted and the stream has
+    // to switch over to the broadcaster
+    bool WriteNextLocked() {
+        if (finished_ || write_in_flight_) {
+            return false;
+        }
+        
+        if (broadcaster_->IsShutdown()) {
+            finished_ = true;
+            Finish(grpc::Status::OK);
+            return false;
+        }
+        
+        if (chunked_item_) {
+            WriteNextChunk();
+            return false;
+        }
+        
+        if (backlog_.empty() && replaying_) {
+            auto events = journal_->ReadAfter(last_sequence_, kJournalReplayBatch, kJournalReplayMaxBytes);
+            if (events.empty()) {
+                replaying_ = false;
+                return true;
+            }
             
-            auto event = ConvertToProto(data);
+            // Missing sequences were pruned from the journal before delivery
+            if (last_sequence_ != 0 && events.front().sequence > last_sequence_ + 1) {
+                replay_dropped_ += events.front().sequence - last_sequence_ - 1;
+            }
+            QueueEvents(std::move(events));
+        } else if (backlog_.empty() && subscriber_ != 0) {
+            QueueEvents(broadcaster_->ReadPending(subscriber_));
+        }
+        
+        if (backlog_.empty()) {
+            return false;
+        }
+        
+        uint64_t sequence = backlog_.front().sequence;
+        auto published_at = backlog_.front().published_at;
+        auto item = std::move(backlog_.front().data);
+        backlog_.pop_front();
+        
+        bool include_payload = filter_.IncludesPayload(*item);
+        grpc::WriteOptions options = WriteOptionsFor(*item, 0);
+        uint64_t memfd_token = 0;
+        if (include_payload && memfd_transport_ && memfd_threshold_ > 0 &&
+            item->data.size() >= memfd_threshold_) {
+            memfd_token = memfd_transport_->Share(item);
+        }
+        
+        if (!include_payload) {
+            current_ = ConvertToProto(*item, false);
+            current_.set_data_omitted(true);
+            current_.set_payload_size(item->data.size());
+            ack_sequence_ = sequence;
+        } else if (memfd_token != 0) {
+            current_ = ConvertToProto(*item, false);
+            current_.set_total_size(item->data.size());
+            current_.set_memfd_token(memfd_token);
+            ack_sequence_ = sequence;
+            service_->memfd_bytes_ += item->data.size();
+        } else if (chunk_size_ > 0 && item->data.size() > chunk_size_) {
+            // Header first, the payload follows from WriteNextChunk()
+            current_ = ConvertToProto(*item, false);
+            current_.set_total_size(item->data.size());
+            chunked_item_ = std::move(item);
+            chunked_sequence_ = sequence;
+            chunked_published_at_ = published_at;
+            chunk_offset_ = 0;
+        } else {
+            current_ = ConvertToProto(*item);
+            ack_sequence_ = sequence;
+            options = WriteOptionsFor(*item, item->data.size());
+            service_->bytes_written_ += item->data.size();
+        }
+        ack_published_at_ = published_at;
+        
+        uint64_t dropped = broadcaster_->GetDroppedCount(subscriber_);
+        current_.set_sequence(sequence);
+        current_.set_epoch(service_->epoch_);
+        current_.set_dropped((dropped - reported_dropped_) + replay_dropped_);
+        reported_dropped_ = dropped;
+        replay_dropped_ = 0;
+        
+        write_in_flight_ = true;
+        StartWrite(&current_, options);
+        return false;
+    }
+    
+    void QueueEvents(std::vector<EventBroadcaster::Event> events) {
+        for (auto& event : events) {
+            // The journal and the ring overlap around the switch-over
+            if (event.sequence <= last_sequence_) {
+                continue;
+            }
+            last_sequence_ = event.sequence;
             
-            if (!writer->Write(event)) {
-                std::cout << "Client disconnected" << std::endl;
-                return grpc::Status::OK;
+            if (filter_.Matches(*event.data)) {
+                backlog_.push_back(std::move(event));
             }
         }
     }
     
-    std::cout << "Stream ended" << std::endl;
-    return grpc::Status::OK;
+    void WriteNextChunk() {
+        const auto& data = chunked_item_->data;
+        size_t length = std::min(chunk_size_, data.size() - chunk_offset_);
+        
+        current_.Clear();
+        current_.set_chunk(true);
+        current_.set_data(data.data() + chunk_offset_, length);
+        chunk_offset_ += length;
+        service_->bytes_written_ += length;
+        
+        grpc::WriteOptions options = WriteOptionsFor(*chunked_item_, length);
+        if (chunk_offset_ >= data.size()) {
+            chunked_item_.reset();
+            chunk_offset_ = 0;
+            ack_sequence_ = chunked_sequence_;
+            ack_published_at_ = chunked_published_at_;
+        }
+        
+        write_in_flight_ = true;
+        StartWrite(&current_, options);
+    }
+    
+    grpc::WriteOptions WriteOptionsFor(const ClipboardData& data, size_t payload_bytes) const {
+        grpc::WriteOptions options;
+        if (compression_threshold_ == 0 || payload_bytes < compression_threshold_ ||
+            IsCompressedMimeType(data.mime_type)) {
+            options.set_no_compression();
+        }
+        return options;
+    }
+    
+    void FinishOnce(grpc::Status status) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!finished_) {
+            finished_ = true;
+            Finish(std::move(status));
+        }
+    }
+    
+    ClipboardServiceImpl* service_;
+    EventBroadcaster* broadcaster_;
+    MemfdTransport* memfd_transport_;
+    CaptureJournal* journal_;
+    EventBroadcaster::SubscriberId subscriber_;
+    const size_t chunk_size_;
+    const size_t memfd_threshold_;
+    const size_t compression_threshold_;
+    const StreamFilter filter_;
+    
+    std::mutex mutex_;
+    bool replaying_;
+    uint64_t last_sequence_;
+    uint64_t chunked_sequence_;
+    uint64_t ack_sequence_;
+    std::chrono::steady_clock::time_point chunked_published_at_;
+    std::chrono::steady_clock::time_point ack_published_at_;
+    // Broadcaster drops already reported, and journal gaps not reported yet
+    uint64_t reported_dropped_;
+    uint64_t replay_dropped_;
+    std::deque<EventBroadcaster::Event> backlog_;
+    ClipboardDataPtr chunked_item_;
+    size_t chunk_offset_;
+    clipboardmanager::ClipboardEvent current_;
+    bool write_in_flight_;
+    bool finished_;
+};
+
+// Ends a stream whose request was rejected before it started
+class ClipboardServiceImpl::RejectedStreamReactor
+    : public grpc::ServerWriteReactor<clipboardmanager::ClipboardEvent> {
+public:
+    explicit RejectedStreamReactor(grpc::Status status) {
+        Finish(std::move(status));
+    }
+    
+    void OnDone() override {
+        delete this;
+    }
+};
+
+ClipboardServiceImpl::ClipboardServiceImpl(IClipboardMonitor* monitor,
+                                           MemfdTransport* memfd_transport,
+                                           CaptureJournal* journal)
+    : monitor_(monitor)
+    , memfd_transport_(memfd_transport)
+    , journal_(journal)
+    , broadcaster_(kEventRingCapacity, kEventRingMaxBytes,
+                   journal ? journal->GetLastSequence() + 1 : 1)
+    , epoch_(journal ? journal->GetEpoch()
+                     : std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::system_clock::now().time_since_epoch()).count())
+    , primary_subscribers_(0)
+    , started_(std::chrono::steady_clock::now())
+{
 }
 
-grpc::Status ClipboardServiceImpl::GetClipboardContent(
-    [[maybe_unused]] grpc::ServerContext* context,
+grpc::ServerWriteReactor<clipboardmanager::ClipboardEvent>* ClipboardServiceImpl::StreamClipboardEvents(
+    grpc::CallbackServerContext* context,
+    const clipboardmanager::StreamEventsRequest* request)
+{
+    size_t chunk_size = request->chunk_size();
+    if (chunk_size > 0) {
+        chunk_size = std::clamp(chunk_size, kMinStreamChunkSize, kMaxStreamChunkSize);
+    }
+    
+    size_t memfd_threshold = request->memfd_threshold();
+    if (memfd_threshold > 0) {
+        memfd_threshold = std::max(memfd_threshold, kMinMemfdThreshold);
+    }
+    
+    // The level maps to the best algorithm the client accepts; messages
+    // below the threshold opt out again in the reactor
+    size_t compression_threshold = request->compression_threshold();
+    if (compression_threshold > 0) {
+        compression_threshold = std::max(compression_threshold, kMinCompressionThreshold);
+        context->set_compression_level(GRPC_COMPRESS_LEVEL_LOW);
+    }
+    
+    const std::string& client_id = request->client_id();
+    if (client_id.size() > kJournalMaxConsumerId) {
+        return new RejectedStreamReactor(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                                      "client_id is too long"));
+    }
+    
+    // Named clients are registered even when they resume, so the journal
+    // keeps what they have not acknowledged yet
+    uint64_t delivered = 0;
+    if (journal_ && !client_id.empty()) {
+        delivered = journal_->RegisterConsumer(client_id);
+    }
+    
+    // A cursor is only meaningful for the epoch it came from. Named clients
+    // without a valid one pick up after their delivered cursor, so events
+    // captured while they were away are not lost; anonymous ones start from
+    // the ring
+    uint64_t resume_after = 0;
+    bool replay = false;
+    if (request->resume_epoch() == epoch_) {
+        resume_after = request->resume_after();
+        replay = true;
+    } else if (!client_id.empty()) {
+        resume_after = delivered;
+        replay = true;
+    }
+    
+    StreamFilter filter;
+    filter.include_primary = request->include_primary();
+    for (int type : request->content_types()) {
+        // The proto and monitor enums share their values
+        filter.content_types.push_back(static_cast<ContentType>(type));
+    }
+    filter.mime_patterns.assign(request->mime_patterns().begin(), request->mime_patterns().end());
+    filter.metadata_only = request->metadata_only();
+    filter.max_payload_bytes = request->max_payload_bytes();
+    
+    return new EventStreamReactor(this, chunk_size, memfd_threshold, compression_threshold,
+                                  std::move(filter), resume_after, replay);
+}
+
+grpc::ServerUnaryReactor* ClipboardServiceImpl::GetClipboardContent(
+    grpc::CallbackServerContext* context,
     [[maybe_unused]] const clipboardmanager::Empty* request,
-    [[maybe_unused]] clipboardmanager::ClipboardContent* response)
+    clipboardmanager::ClipboardContent* response)
+{
+    auto* reactor = context->DefaultReactor();
+    
+    // Served from the monitor's snapshot, no compositor round-trip
+    auto snapshot = monitor_->GetCurrentContent();
+    if (!snapshot) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "No clipboard content captured yet"));
+        return reactor;
+    }
+    
+    FillContent(*snapshot, response);
+    
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+grpc::ServerUnaryReactor* ClipboardServiceImpl::GetClipboardFormat(
+    grpc::CallbackServerContext* context,
+    const clipboardmanager::FormatRequest* request,
+    clipboardmanager::ClipboardContent* response)
+{
+    auto* reactor = context->DefaultReactor();
+    
+    if (request->mime_type().empty()) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "mime_type is required"));
+        return reactor;
+    }
+    
+    // Completed from the monitor thread once the source has written the
+    // format; the response stays valid until Finish()
+    monitor_->RequestFormat(request->mime_type(), [reactor, response](ClipboardDataPtr data) {
+        if (!data) {
+            reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND,
+                                         "Format not available for the current selection"));
+            return;
+        }
+        
+        FillContent(*data, response);
+        reactor->Finish(grpc::Status::OK);
+    });
+    
+    return reactor;
+}
+
+grpc::ServerUnaryReactor* ClipboardServiceImpl::SetClipboardContent(
+    grpc::CallbackServerContext* context,
+    const clipboardmanager::ClipboardContent* request,
+    [[maybe_unused]] clipboardmanager::Empty* response)
+{
+    auto* reactor = context->DefaultReactor();
+    
+    if (request->data().empty() || request->mime_type().empty()) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                     "data and mime_type are required"));
+        return reactor;
+    }
+    
+    // The monitor serves this snapshot to every reader until it is replaced
+    ClipboardData content;
+    content.data.assign(request->data().begin(), request->data().end());
+    content.mime_type = request->mime_type();
+    content.content_type = ContentTypeForMime(content.mime_type);
+    content.source_app = "clipboard-daemon";
+    content.window_title = "clipboard-daemon";
+    content.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    content.available_mime_types = OfferedMimeTypes(content.mime_type);
+    content.content_hash = ContentHasher::Hash(content.data);
+    
+    monitor_->SetSelection(std::make_shared<const ClipboardData>(std::move(content)),
+        [reactor](bool owned) {
+            reactor->Finish(owned ? grpc::Status::OK
+                                  : grpc::Status(grpc::StatusCode::UNAVAILABLE,
+                                                 "Could not take the clipboard selection"));
+        });
+    
+    return reactor;
+}
+
+grpc::ServerUnaryReactor* ClipboardServiceImpl::GetStats(
+    grpc::CallbackServerContext* context,
+    [[maybe_unused]] const clipboardmanager::Empty* request,
+    clipboardmanager::DaemonStats* response)
+{
+    auto* reactor = context->DefaultReactor();
+    CollectStats(response);
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+grpc::ServerUnaryReactor* ClipboardServiceImpl::AcknowledgeEvents(
+    grpc::CallbackServerContext* context,
+    const clipboardmanager::AcknowledgeRequest* request,
+    [[maybe_unused]] clipboardmanager::Empty* response)
+{
+    auto* reactor = context->DefaultReactor();
+    
+    if (request->client_id().empty() || request->client_id().size() > kJournalMaxConsumerId) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                     "client_id must be 1 to 55 bytes"));
+        return reactor;
+    }
+    
+    if (request->epoch() != epoch_) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                                     "Sequence is from another daemon epoch"));
+        return reactor;
+    }
+    
+    // Without a journal nothing outlives this run, so there is nothing to keep
+    if (journal_) {
+        journal_->Acknowledge(request->client_id(), request->sequence());
+    }
+    
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+void ClipboardServiceImpl::CollectStats(clipboardmanager::DaemonStats* stats) const {
+    stats->set_uptime_seconds(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - started_).count());
+    
+    CaptureStats capture = monitor_->GetCaptureStats();
+    stats->set_captures(capture.captures);
+    stats->set_capture_bytes(capture.capture_bytes);
+    stats->set_duplicates(capture.duplicates);
+    stats->set_reads(capture.reads);
+    stats->set_read_failures(capture.read_failures);
+    stats->set_read_bytes(capture.read_bytes);
+    FillHistogram(capture.read_latency, stats->mutable_read_latency());
+    for (const auto& mime : capture.mime_types) {
+        auto* mime_stats = stats->add_mime_types();
+        mime_stats->set_mime_type(mime.mime_type);
+        mime_stats->set_reads(mime.reads);
+        mime_stats->set_failures(mime.failures);
+        mime_stats->set_bytes(mime.bytes);
+        FillHistogram(mime.latency, mime_stats->mutable_read_latency());
+    }
+    
+    if (const ChangeCoalescer* coalescer = coalescer_) {
+        ChangeCoalescer::Stats coalescing = coalescer->GetStats();
+        stats->set_coalescer_received(coalescing.received);
+        stats->set_coalescer_emitted(coalescing.emitted);
+        stats->set_coalescer_collapsed(coalescing.collapsed);
+        FillHistogram(coalescing.delay, stats->mutable_coalesce_delay());
+    }
+    
+    EventBroadcaster::Stats ring = broadcaster_.GetStats();
+    stats->set_next_sequence(ring.next_sequence);
+    stats->set_ring_events(ring.retained_events);
+    stats->set_ring_bytes(ring.retained_bytes);
+    stats->set_ring_capacity(ring.capacity);
+    stats->set_ring_max_bytes(ring.max_bytes);
+    for (const auto& subscriber : ring.subscribers) {
+        auto* subscriber_stats = stats->add_subscribers();
+        subscriber_stats->set_id(subscriber.id);
+        subscriber_stats->set_lag(subscriber.lag);
+        subscriber_stats->set_dropped(subscriber.dropped);
+    }
+    
+    stats->set_events_written(events_written_);
+    stats->set_bytes_written(bytes_written_);
+    stats->set_memfd_bytes(memfd_bytes_);
+    FillHistogram(publish_to_write_.GetSnapshot(), stats->mutable_publish_to_write());
+}
+
+void ClipboardServiceImpl::OnClipboardChanged(const ClipboardDataPtr& data) {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    if (journal_ && !journal_->Append(broadcaster_.GetNextSequence(), *data)) {
+        std::cerr << "⚠️  Failed to journal clipboard event" << std::endl;
+    }
+    broadcaster_.Publish(data);
+}
+
+void ClipboardServiceImpl::Shutdown() {
+    broadcaster_.Shutdown();
+}
+
+void ClipboardServiceImpl::AddPrimarySubscriber() {
+    std::lock_guard<std::mutex> lock(primary_subscribers_mutex_);
+    if (primary_subscribers_++ == 0) {
+        std::cout << "Primary selection capture enabled" << std::endl;
+        monitor_->SetPrimarySelectionEnabled(true);
+    }
+}
+
+void ClipboardServiceImpl::RemovePrimarySubscriber() {
+    std::lock_guard<std::mutex> lock(primary_subscribers_mutex_);
+    if (--primary_subscribers_ == 0) {
+        std::cout << "Primary selection capture disabled" << std::endl;
+        monitor_->SetPrimarySelectionEnabled(false);
+    }
+}
+
+void ClipboardServiceImpl::FillContent(
+    const ClipboardData& data,
+    clipboardmanager::ClipboardContent* content)
 {
-    // TODO: Implement getting current clipboard content
-    return grpc::Status(grpc::StatusCode::UNIMPLEMENTED, "Not implemented yet");
+    content->set_data(data.data.data(), data.data.size());
+    content->set_mime_type(data.mime_type);
+    content->set_content_type(ConvertContentType(data.content_type));
+    if (!data.content_hash.IsEmpty()) {
+        content->set_content_hash(data.content_hash.ToBytes());
+    }
+    for (const auto& mime_type : data.available_mime_types) {
+        content->add_available_mime_types(mime_type);
+    }
 }
 
-void ClipboardServiceImpl::OnClipboardChanged(const ClipboardData& data) {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    event_queue_.push(data);
-    queue_cv_.notify_all();
+void ClipboardServiceImpl::FillHistogram(
+    const LatencyHistogram::Snapshot& snapshot,
+    clipboardmanager::LatencyHistogram* histogram)
+{
+    for (size_t bucket = 0; bucket < LatencyHistogram::kBuckets; bucket++) {
+        if (bucket + 1 < LatencyHistogram::kBuckets) {
+            histogram->add_upper_bounds_us(LatencyHistogram::BucketUpperBound(bucket));
+        }
+        histogram->add_counts(snapshot.counts[bucket]);
+    }
+    histogram->set_count(snapshot.count);
+    histogram->set_sum_us(snapshot.sum_us);
+    histogram->set_max_us(snapshot.max_us);
 }
 
-clipboardmanager::ClipboardEvent ClipboardServiceImpl::ConvertToProto(const ClipboardData& data) {
+clipboardmanager::ClipboardEvent ClipboardServiceImpl::ConvertToProto(
+    const ClipboardData& data,
+    bool include_payload)
+{
     clipboardmanager::ClipboardEvent event;
     
-    event.set_data(data.data.data(), data.data.size());
+    if (include_payload) {
+        event.set_data(data.data.data(), data.data.size());
+    }
     event.set_source_app(data.source_app);
     event.set_window_title(data.window_title);
     event.set_timestamp(data.timestamp);
     event.set_mime_type(data.mime_type);
     
-    // Convert content type
-    switch (data.content_type) {
+    event.set_content_type(ConvertContentType(data.content_type));
+    event.set_selection(ConvertSelection(data.selection));
+    if (!data.content_hash.IsEmpty()) {
+        event.set_content_hash(data.content_hash.ToBytes());
+    }
+    for (const auto& mime_type : data.available_mime_types) {
+        event.add_available_mime_types(mime_type);
+    }
+    
+    return event;
+}
+
+clipboardmanager::ContentType ClipboardServiceImpl::ConvertContentType(ContentType type) {
+    switch (type) {
         case ContentType::TEXT:
-            event.set_content_type(clipboardmanager::ContentType::TEXT);
-            break;
+            return clipboardmanager::ContentType::TEXT;
         case ContentType::IMAGE:
-            event.set_content_type(clipboardmanager::ContentType::IMAGE);
-            break;
+            return clipboardmanager::ContentType::IMAGE;
         case ContentType::HTML:
-            event.set_content_type(clipboardmanager::ContentType::HTML);
-            break;
+            return clipboardmanager::ContentType::HTML;
         case ContentType::FILE:
-            event.set_content_type(clipboardmanager::ContentType::FILE);
-            break;
+            return clipboardmanager::ContentType::FILE;
         default:
-            event.set_content_type(clipboardmanager::ContentType::UNKNOWN);
-            break;
+            return clipboardmanager::ContentType::UNKNOWN;
+    }
+}
+
+clipboardmanager::Selection ClipboardServiceImpl::ConvertSelection(Selection selection) {
+    switch (selection) {
+        case Selection::PRIMARY:
+            return clipboardmanager::Selection::PRIMARY;
+        default:
+            return clipboardmanager::Selection::CLIPBOARD;
     }
-    
-    return event;
 }
 
 // GrpcServer implementation
 
 GrpcServer::GrpcServer(const std::string& server_address, IClipboardMonitor* monitor)
 {
-    service_ = std::make_unique<ClipboardServiceImpl>(monitor);
+    // Captures are journaled so they outlive client and daemon restarts
+    auto journal_dir = CaptureJournal::DefaultDirectory();
+    if (!journal_dir.empty()) {
+        journal_ = std::make_unique<CaptureJournal>(journal_dir);
+        if (!journal_->Open()) {
+            journal_.reset();
+        }
+    }
+    
+    // Local clients can receive large payloads as memfds over a side socket
+    auto fd_socket_path = MemfdTransport::SocketPathFor(server_address);
+    if (!fd_socket_path.empty()) {
+        memfd_transport_ = std::make_unique<MemfdTransport>();
+        if (!memfd_transport_->Start(fd_socket_path)) {
+            memfd_transport_.reset();
+        }
+    }
+    
+    service_ = std::make_unique<ClipboardServiceImpl>(monitor, memfd_transport_.get(),
+                                                      journal_.get());
     
     grpc::ServerBuilder builder;
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
     builder.RegisterService(service_.get());
+    builder.SetMaxReceiveMessageSize(kMaxMessageSize);
+    builder.SetMaxSendMessageSize(kMaxMessageSize);
     
     server_ = builder.BuildAndStart();
     
@@ -117,9 +770,13 @@ void GrpcServer::Run() {
 }
 
 void GrpcServer::Shutdown() {
+    service_->Shutdown();
     if (server_) {
         server_->Shutdown();
     }
+    if (memfd_transport_) {
+        memfd_transport_->Stop();
+    }
 }
 
 } // namespace clipboard
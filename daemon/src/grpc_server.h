@@ -1,38 +1,146 @@
 #pragma once
 
+#include "capture_journal.h"
+#include "change_coalescer.h"
 #include "clipboard_monitor.h"
+#include "event_broadcaster.h"
+#include "latency_histogram.h"
+#include "memfd_transport.h"
 #include "clipboard.grpc.pb.h"
 #include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
 #include <memory>
-#include <queue>
 #include <mutex>
-#include <condition_variable>
+#include <string>
+#include <vector>
 
 namespace clipboard {
 
-class ClipboardServiceImpl final : public clipboardmanager::ClipboardService::Service {
+// Event ring limits shared by all stream subscribers. The ring is also the
+// replay log for clients that resume a stream.
+constexpr size_t kEventRingCapacity = 256;
+constexpr size_t kEventRingMaxBytes = 64 * 1024 * 1024;
+
+// Bounds for the chunk size a client may request for chunked streaming
+constexpr size_t kMinStreamChunkSize = 16 * 1024;
+constexpr size_t kMaxStreamChunkSize = 2 * 1024 * 1024;
+
+// Smallest payload a client may ask to receive through a memfd
+constexpr size_t kMinMemfdThreshold = 64 * 1024;
+
+// Smallest payload a client may ask to have compressed; below it the
+// compression framing outweighs the savings
+constexpr size_t kMinCompressionThreshold = 1024;
+
+// Largest unary message either way: GetClipboardContent and
+// GetClipboardFormat answer and SetClipboardContent receives whole payloads,
+// well above gRPC's 4 MB default
+constexpr int kMaxMessageSize = 512 * 1024 * 1024;
+
+// Journal events read per step while a stream drains the journal. The
+// payloads of a step are copied out of the journal, so a step also stops at
+// the ring's byte budget; a larger event is read on its own.
+constexpr size_t kJournalReplayBatch = 16;
+constexpr size_t kJournalReplayMaxBytes = kEventRingMaxBytes;
+
+// Per-stream event filter from StreamEventsRequest, applied before an event
+// is converted to its proto form
+struct StreamFilter {
+    bool include_primary = false;
+    std::vector<ContentType> content_types;
+    std::vector<std::string> mime_patterns;
+    bool metadata_only = false;
+    size_t max_payload_bytes = 0;
+    
+    bool Matches(const ClipboardData& data) const;
+    bool IncludesPayload(const ClipboardData& data) const;
+};
+
+// Uses the gRPC callback API: streams are driven by reactors that are woken
+// by the broadcaster, so idle subscribers hold no threads.
+class ClipboardServiceImpl final : public clipboardmanager::ClipboardService::CallbackService {
 public:
-    ClipboardServiceImpl(IClipboardMonitor* monitor);
+    ClipboardServiceImpl(IClipboardMonitor* monitor,
+                         MemfdTransport* memfd_transport,
+                         CaptureJournal* journal);
     
-    grpc::Status StreamClipboardEvents(
-        grpc::ServerContext* context,
-        const clipboardmanager::Empty* request,
-        grpc::ServerWriter<clipboardmanager::ClipboardEvent>* writer) override;
+    grpc::ServerWriteReactor<clipboardmanager::ClipboardEvent>* StreamClipboardEvents(
+        grpc::CallbackServerContext* context,
+        const clipboardmanager::StreamEventsRequest* request) override;
     
-    grpc::Status GetClipboardContent(
-        grpc::ServerContext* context,
+    grpc::ServerUnaryReactor* GetClipboardContent(
+        grpc::CallbackServerContext* context,
         const clipboardmanager::Empty* request,
         clipboardmanager::ClipboardContent* response) override;
     
-    void OnClipboardChanged(const ClipboardData& data);
+    grpc::ServerUnaryReactor* GetClipboardFormat(
+        grpc::CallbackServerContext* context,
+        const clipboardmanager::FormatRequest* request,
+        clipboardmanager::ClipboardContent* response) override;
+    
+    grpc::ServerUnaryReactor* SetClipboardContent(
+        grpc::CallbackServerContext* context,
+        const clipboardmanager::ClipboardContent* request,
+        clipboardmanager::Empty* response) override;
+    
+    grpc::ServerUnaryReactor* GetStats(
+        grpc::CallbackServerContext* context,
+        const clipboardmanager::Empty* request,
+        clipboardmanager::DaemonStats* response) override;
+    
+    grpc::ServerUnaryReactor* AcknowledgeEvents(
+        grpc::CallbackServerContext* context,
+        const clipboardmanager::AcknowledgeRequest* request,
+        clipboardmanager::Empty* response) override;
+    
+    void OnClipboardChanged(const ClipboardDataPtr& data);
+    void Shutdown();
+    
+    // Coalescer in front of OnClipboardChanged whose counters GetStats reports
+    void SetCoalescer(const ChangeCoalescer* coalescer) { coalescer_ = coalescer; }
+    
+    // Snapshot of every metric, as returned by GetStats
+    void CollectStats(clipboardmanager::DaemonStats* stats) const;
 
 private:
+    class EventStreamReactor;
+    class RejectedStreamReactor;
+    
+    // Keeps primary selection capture enabled while any stream wants it
+    void AddPrimarySubscriber();
+    void RemovePrimarySubscriber();
+    
     IClipboardMonitor* monitor_;
-    std::queue<ClipboardData> event_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable queue_cv_;
+    MemfdTransport* memfd_transport_;
+    CaptureJournal* journal_;
+    EventBroadcaster broadcaster_;
+    
+    // Qualifies sequence numbers: the journal's epoch, in which they continue
+    // across daemon runs, or this run's start time without a journal
+    const uint64_t epoch_;
+    
+    // Keeps journal order identical to publish order
+    std::mutex publish_mutex_;
+    
+    std::mutex primary_subscribers_mutex_;
+    size_t primary_subscribers_;
+    
+    // Delivery metrics, updated by the stream reactors
+    const std::chrono::steady_clock::time_point started_;
+    std::atomic<const ChangeCoalescer*> coalescer_{nullptr};
+    std::atomic<uint64_t> events_written_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> memfd_bytes_{0};
+    LatencyHistogram publish_to_write_;
     
-    clipboardmanager::ClipboardEvent ConvertToProto(const ClipboardData& data);
+    static void FillHistogram(const LatencyHistogram::Snapshot& snapshot,
+                              clipboardmanager::LatencyHistogram* histogram);
+    static clipboardmanager::ClipboardEvent ConvertToProto(const ClipboardData& data,
+                                                           bool include_payload = true);
+    static void FillContent(const ClipboardData& data, clipboardmanager::ClipboardContent* content);
+    static clipboardmanager::ContentType ConvertContentType(ContentType type);
+    static clipboardmanager::Selection ConvertSelection(Selection selection);
 };
 
 class GrpcServer {
@@ -46,7 +154,9 @@ public:
     ClipboardServiceImpl* GetService() { return service_.get(); }
 
 private:
+    std::unique_ptr<CaptureJournal> journal_;
     std::unique_ptr<grpc::Server> server_;
+    std::unique_ptr<MemfdTransport> memfd_transport_;
     std::unique_ptr<ClipboardServiceImpl> service_;
 };
 
@@ -0,0 +1,61 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace clipboard {
+
+uint64_t LatencyHistogram::Snapshot::Percentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    
+    auto rank = static_cast<uint64_t>(std::ceil(count * std::clamp(percentile, 0.0, 100.0) / 100.0));
+    rank = std::max<uint64_t>(rank, 1);
+    
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            uint64_t bound = BucketUpperBound(bucket);
+            return bound == 0 ? max_us : std::min(bound, max_us);
+        }
+    }
+    
+    // Counters are read one by one while samples keep arriving
+    return max_us;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t bucket) {
+    return bucket + 1 < kBuckets ? uint64_t(1) << bucket : 0;
+}
+
+void LatencyHistogram::Record(std::chrono::steady_clock::duration duration) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    uint64_t value = us > 0 ? static_cast<uint64_t>(us) : 0;
+    
+    size_t bucket = 0;
+    while (bucket + 1 < kBuckets && value >= BucketUpperBound(bucket)) {
+        bucket++;
+    }
+    
+    counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(value, std::memory_order_relaxed);
+    
+    uint64_t max = max_us_.load(std::memory_order_relaxed);
+    while (value > max && !max_us_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::GetSnapshot() const {
+    Snapshot snapshot;
+    for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+        snapshot.counts[bucket] = counts_[bucket].load(std::memory_order_relaxed);
+    }
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sum_us = sum_us_.load(std::memory_order_relaxed);
+    snapshot.max_us = max_us_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+} // namespace clipboard
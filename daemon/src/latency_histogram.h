@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace clipboard {
+
+// Lock-free histogram of durations in power-of-two microsecond buckets:
+// bucket 0 holds samples below 1 us, bucket i those in [2^(i-1), 2^i) us and
+// the last bucket everything longer. Safe to record from any thread.
+class LatencyHistogram {
+public:
+    static constexpr size_t kBuckets = 28; // Last bound is 2^26 us, about 67 s
+    
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> counts{};
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+        uint64_t max_us = 0;
+        
+        // Upper bound of the bucket holding the given percentile (0-100),
+        // capped at the largest recorded sample
+        uint64_t Percentile(double percentile) const;
+    };
+    
+    // Exclusive upper bound of a bucket in microseconds, 0 for the open one
+    static uint64_t BucketUpperBound(size_t bucket);
+    
+    void Record(std::chrono::steady_clock::duration duration);
+    Snapshot GetSnapshot() const;
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_us_{0};
+    std::atomic<uint64_t> max_us_{0};
+};
+
+} // namespace clipboard
@@ -1,7 +1,12 @@
+#include "capture_trace.h"
+#include "change_coalescer.h"
 #include "clipboard_monitor.h"
 #include "grpc_server.h"
+#include <algorithm>
+#include <google/protobuf/util/json_util.h>
 #include <iostream>
 #include <csignal>
+#include <cstdlib>
 #include <atomic>
 #include <thread>
 
@@ -20,6 +25,9 @@ int main(int argc, char* argv[]) {
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
     
+    // Paste targets may close their pipe before the selection was written
+    std::signal(SIGPIPE, SIG_IGN);
+    
     // Parse command line arguments
     std::string server_address = "unix:///tmp/clipboard-daemon.sock";
     
@@ -40,9 +48,41 @@ int main(int argc, char* argv[]) {
     // Create gRPC server
     clipboard::GrpcServer grpc_server(server_address, monitor.get());
     
+    // Bursts of changes are collapsed before they reach the service
+    std::chrono::milliseconds settle_window = clipboard::kDefaultSettleWindow;
+    if (const char* settle_ms = std::getenv("CLIPBOARD_SETTLE_MS")) {
+        settle_window = std::chrono::milliseconds(std::atoi(settle_ms));
+    }
+    
+    clipboard::ChangeCoalescer coalescer(settle_window,
+        [&grpc_server](const clipboard::ClipboardDataPtr& data) {
+            grpc_server.GetService()->OnClipboardChanged(data);
+        });
+    
+    std::cout << "Settle window: " << coalescer.GetSettleWindow().count() << " ms" << std::endl;
+    grpc_server.GetService()->SetCoalescer(&coalescer);
+    
+    // Same metrics as the GetStats RPC, dumped as one JSON line per interval
+    std::chrono::seconds stats_interval(0);
+    if (const char* interval = std::getenv("CLIPBOARD_STATS_INTERVAL")) {
+        stats_interval = std::chrono::seconds(std::max(std::atoi(interval), 0));
+    }
+    
+    // Every capture can be recorded for later replay with CLIPBOARD_REPLAY
+    std::unique_ptr<clipboard::TraceRecorder> recorder;
+    if (const char* trace_path = std::getenv("CLIPBOARD_TRACE_RECORD")) {
+        recorder = std::make_unique<clipboard::TraceRecorder>(trace_path);
+        if (!recorder->Open()) {
+            recorder.reset();
+        }
+    }
+    
     // Setup clipboard change callback
-    monitor->OnClipboardChanged = [&grpc_server](const clipboard::ClipboardData& data) {
-        grpc_server.GetService()->OnClipboardChanged(data);
+    monitor->OnClipboardChanged = [&coalescer, &recorder](const clipboard::ClipboardDataPtr& data) {
+        if (recorder) {
+            recorder->Record(*data);
+        }
+        coalescer.Submit(data);
     };
     
     // Start monitor in separate thread
@@ -56,19 +96,35 @@ int main(int argc, char* argv[]) {
     });
     
     // Wait for shutdown signal
+    auto next_stats_dump = std::chrono::steady_clock::now() + stats_interval;
     while (g_running) {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        
+        if (stats_interval.count() > 0 && std::chrono::steady_clock::now() >= next_stats_dump) {
+            next_stats_dump += stats_interval;
+            
+            clipboardmanager::DaemonStats stats;
+            grpc_server.GetService()->CollectStats(&stats);
+            std::string json;
+            if (google::protobuf::util::MessageToJsonString(stats, &json).ok()) {
+                std::cout << "📊 " << json << std::endl;
+            }
+        }
     }
     
     // Cleanup
     std::cout << "Shutting down..." << std::endl;
     monitor->Stop();
-    grpc_server.Shutdown();
     
     if (monitor_thread.joinable()) {
         monitor_thread.join();
     }
     
+    // Forward the last settled change before the streams are closed
+    coalescer.Stop();
+    grpc_server.GetService()->SetCoalescer(nullptr);
+    grpc_server.Shutdown();
+    
     if (grpc_thread.joinable()) {
         grpc_thread.join();
     }
@@ -0,0 +1,257 @@
+#include "memfd_transport.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace clipboard {
+
+MemfdTransport::MemfdTransport()
+    : listen_fd_(-1)
+    , stop_fd_(-1)
+    , running_(false)
+    , next_token_(1)
+{
+}
+
+MemfdTransport::~MemfdTransport() {
+    Stop();
+}
+
+std::string MemfdTransport::SocketPathFor(const std::string& server_address) {
+    const std::string prefix = "unix://";
+    if (server_address.rfind(prefix, 0) != 0) {
+        return "";
+    }
+    return server_address.substr(prefix.size()) + ".fd";
+}
+
+bool MemfdTransport::Start(const std::string& socket_path) {
+    sockaddr_un addr{};
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "Failed to create fd socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socket_path.c_str());
+
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listen_fd_, 16) < 0) {
+        std::cerr << "Failed to listen on " << socket_path << ": " << strerror(errno) << std::endl;
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    // Payload tokens are only for this user
+    chmod(socket_path.c_str(), 0600);
+
+    stop_fd_ = eventfd(0, EFD_CLOEXEC);
+    socket_path_ = socket_path;
+    running_ = true;
+    thread_ = std::thread([this] { Serve(); });
+
+    std::cout << "memfd transport listening on " << socket_path_ << std::endl;
+    return true;
+}
+
+void MemfdTransport::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(stop_fd_, &one, sizeof(one));
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    close(listen_fd_);
+    close(stop_fd_);
+    listen_fd_ = -1;
+    stop_fd_ = -1;
+    unlink(socket_path_.c_str());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : entries_) {
+        close(entry.fd);
+    }
+    entries_.clear();
+}
+
+uint64_t MemfdTransport::Share(const ClipboardDataPtr& data) {
+    if (!running_ || !data || data->data.empty()) {
+        return 0;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    Prune(now);
+
+    // Every subscriber of the same event shares one memfd
+    for (auto& entry : entries_) {
+        if (entry.data == data) {
+            entry.unfetched++;
+            entry.shared_at = now;
+            return entry.token;
+        }
+    }
+
+    int fd = CreateSealedMemfd(*data);
+    if (fd < 0) {
+        return 0;
+    }
+
+    uint64_t token = next_token_++;
+    entries_.push_back({token, data, fd, 1, now});
+    return token;
+}
+
+void MemfdTransport::Prune(std::chrono::steady_clock::time_point now) {
+    size_t retained = entries_.size();
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        bool expired = now - it->shared_at >= kMemfdPinTimeout;
+        bool evictable = it->unfetched == 0 && retained > kMemfdCacheEntries;
+        if (expired || evictable) {
+            close(it->fd);
+            it = entries_.erase(it);
+            retained--;
+        } else {
+            ++it;
+        }
+    }
+}
+
+int MemfdTransport::CreateSealedMemfd(const ClipboardData& data) {
+    int fd = memfd_create("clipboard-payload", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        std::cerr << "memfd_create failed: " << strerror(errno) << std::endl;
+        return -1;
+    }
+
+    const uint8_t* cursor = data.data.data();
+    size_t remaining = data.data.size();
+
+    while (remaining > 0) {
+        ssize_t written = write(fd, cursor, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "memfd write failed: " << strerror(errno) << std::endl;
+            close(fd);
+            return -1;
+        }
+        cursor += written;
+        remaining -= written;
+    }
+
+    // Clients map the payload directly, so it must never change under them
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+        std::cerr << "memfd sealing failed: " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void MemfdTransport::Serve() {
+    while (running_) {
+        struct pollfd fds[2] = {
+            { .fd = listen_fd_, .events = POLLIN, .revents = 0 },
+            { .fd = stop_fd_, .events = POLLIN, .revents = 0 }
+        };
+
+        int ret = poll(fds, 2, -1);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "fd socket poll error: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int client_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client_fd >= 0) {
+                HandleClient(client_fd);
+                close(client_fd);
+            }
+        }
+    }
+}
+
+void MemfdTransport::HandleClient(int client_fd) {
+    // A stuck client must not block the transport
+    timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    uint64_t token = 0;
+    if (recv(client_fd, &token, sizeof(token), MSG_WAITALL) != sizeof(token)) {
+        return;
+    }
+
+    int payload_fd = -1;
+    uint64_t size = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : entries_) {
+            if (entry.token == token) {
+                // Own a reference so eviction cannot close it mid-send
+                payload_fd = dup(entry.fd);
+                size = entry.data->data.size();
+                if (entry.unfetched > 0) {
+                    entry.unfetched--;
+                }
+                break;
+            }
+        }
+    }
+
+    // Reply is the payload size, with the memfd attached when the token is known
+    iovec iov = { .iov_base = &size, .iov_len = sizeof(size) };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (payload_fd >= 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &payload_fd, sizeof(int));
+    }
+
+    sendmsg(client_fd, &msg, MSG_NOSIGNAL);
+
+    if (payload_fd >= 0) {
+        close(payload_fd);
+    }
+}
+
+} // namespace clipboard
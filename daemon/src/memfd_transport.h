@@ -0,0 +1,74 @@
+#pragma once
+
+#include "clipboard_monitor.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace clipboard {
+
+// Number of fetched payloads kept open for late subscribers of the same event
+constexpr size_t kMemfdCacheEntries = 8;
+
+// Payloads handed out but not fetched are kept at least this long; a client
+// that fell this far behind replays the event without memfd
+constexpr std::chrono::seconds kMemfdPinTimeout(30);
+
+// Local zero-copy hand-off for large payloads.
+//
+// Share() copies a capture once into a sealed memfd and returns a token that
+// is sent to the client in the event header. The client connects to the fd
+// socket, writes the token and receives the memfd through SCM_RIGHTS, then
+// maps it read-only. Recently shared payloads are cached so every subscriber
+// of the same event gets the same memfd. A payload stays pinned until every
+// token handed out for it was fetched or kMemfdPinTimeout passed, so a
+// burst of large captures cannot evict one a client has yet to fetch.
+class MemfdTransport {
+public:
+    MemfdTransport();
+    ~MemfdTransport();
+
+    bool Start(const std::string& socket_path);
+    void Stop();
+    bool IsRunning() const { return running_; }
+
+    // Returns the token for the payload, or 0 if it could not be shared.
+    // Each call pins the payload for one more fetch.
+    uint64_t Share(const ClipboardDataPtr& data);
+
+    // Fd socket path for a gRPC address, empty if the address is not a unix socket
+    static std::string SocketPathFor(const std::string& server_address);
+
+private:
+    struct Entry {
+        uint64_t token;
+        ClipboardDataPtr data;
+        int fd;
+        size_t unfetched;
+        std::chrono::steady_clock::time_point shared_at;
+    };
+    
+    // Closes expired entries, then fetched ones beyond kMemfdCacheEntries,
+    // oldest first. Called with mutex_ held.
+    void Prune(std::chrono::steady_clock::time_point now);
+
+    void Serve();
+    void HandleClient(int client_fd);
+    int CreateSealedMemfd(const ClipboardData& data);
+
+    std::string socket_path_;
+    int listen_fd_;
+    int stop_fd_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+
+    std::mutex mutex_;
+    std::deque<Entry> entries_;
+    uint64_t next_token_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,101 @@
+#include "metadata_codec.h"
+#include <cstring>
+
+namespace clipboard {
+
+namespace {
+
+void PutU64(std::string& out, uint64_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutString(std::string& out, const std::string& value) {
+    uint32_t length = static_cast<uint32_t>(value.size());
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.append(value);
+}
+
+class MetadataReader {
+public:
+    MetadataReader(const uint8_t* data, size_t size) : data_(data), size_(size), offset_(0) {}
+
+    bool Read(void* out, size_t length) {
+        if (size_ - offset_ < length) {
+            return false;
+        }
+        std::memcpy(out, data_ + offset_, length);
+        offset_ += length;
+        return true;
+    }
+
+    bool ReadString(std::string& out) {
+        uint32_t length = 0;
+        if (!Read(&length, sizeof(length)) || size_ - offset_ < length) {
+            return false;
+        }
+        out.assign(reinterpret_cast<const char*>(data_ + offset_), length);
+        offset_ += length;
+        return true;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_;
+};
+
+} // namespace
+
+std::string EncodeClipboardMetadata(const ClipboardData& data) {
+    std::string out;
+    PutU64(out, static_cast<uint64_t>(data.timestamp));
+    out.push_back(static_cast<char>(data.content_type));
+    out.push_back(static_cast<char>(data.selection));
+    PutU64(out, data.content_hash.high);
+    PutU64(out, data.content_hash.low);
+    PutString(out, data.mime_type);
+    PutString(out, data.source_app);
+    PutString(out, data.window_title);
+    PutU64(out, data.available_mime_types.size());
+    for (const auto& mime_type : data.available_mime_types) {
+        PutString(out, mime_type);
+    }
+    return out;
+}
+
+bool DecodeClipboardMetadata(const uint8_t* metadata, size_t size, ClipboardData& data) {
+    MetadataReader reader(metadata, size);
+    uint64_t timestamp = 0;
+    uint8_t content_type = 0;
+    uint8_t selection = 0;
+    uint64_t mime_count = 0;
+
+    if (!reader.Read(&timestamp, sizeof(timestamp)) ||
+        !reader.Read(&content_type, sizeof(content_type)) ||
+        !reader.Read(&selection, sizeof(selection)) ||
+        !reader.Read(&data.content_hash.high, sizeof(data.content_hash.high)) ||
+        !reader.Read(&data.content_hash.low, sizeof(data.content_hash.low)) ||
+        !reader.ReadString(data.mime_type) ||
+        !reader.ReadString(data.source_app) ||
+        !reader.ReadString(data.window_title) ||
+        !reader.Read(&mime_count, sizeof(mime_count))) {
+        return false;
+    }
+
+    data.timestamp = static_cast<int64_t>(timestamp);
+    data.content_type = static_cast<ContentType>(content_type);
+    data.selection = selection == static_cast<uint8_t>(Selection::PRIMARY)
+        ? Selection::PRIMARY
+        : Selection::CLIPBOARD;
+
+    for (uint64_t i = 0; i < mime_count; i++) {
+        std::string mime_type;
+        if (!reader.ReadString(mime_type)) {
+            return false;
+        }
+        data.available_mime_types.push_back(std::move(mime_type));
+    }
+    return true;
+}
+
+} // namespace clipboard
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "clipboard_monitor.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace clipboard {
+
+// Compact binary form of everything in ClipboardData except the payload,
+// shared by the capture journal and trace files. Native byte order; both
+// are only read back on the machine that wrote them.
+std::string EncodeClipboardMetadata(const ClipboardData& data);
+
+// Fills the metadata fields of data; false if the encoding is truncated
+bool DecodeClipboardMetadata(const uint8_t* metadata, size_t size, ClipboardData& data);
+
+} // namespace clipboard
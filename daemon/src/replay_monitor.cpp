@@ -0,0 +1,319 @@
+#include "replay_monitor.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace clipboard {
+
+static constexpr char kSyntheticPrefix[] = "synthetic:";
+
+ReplayMonitor::ReplayMonitor(std::string source, double speed, bool loop)
+    : source_(std::move(source))
+    , speed_(std::max(speed, 0.0))
+    , loop_(loop)
+    , synthetic_(false)
+    , generated_(0)
+    , trace_index_(0)
+    , running_(false)
+    , wake_fd_(-1)
+{
+}
+
+ReplayMonitor::~ReplayMonitor() {
+    Stop();
+    FailPendingSelections();
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+    }
+}
+
+bool ReplayMonitor::ParseWorkload(const std::string& spec, SyntheticWorkload& workload) {
+    std::string options = spec.rfind(kSyntheticPrefix, 0) == 0
+        ? spec.substr(std::strlen(kSyntheticPrefix))
+        : spec;
+
+    std::stringstream stream(options);
+    std::string entry;
+    while (std::getline(stream, entry, ',')) {
+        auto separator = entry.find('=');
+        if (separator == std::string::npos) {
+            return false;
+        }
+
+        std::string key = entry.substr(0, separator);
+        std::string value = entry.substr(separator + 1);
+        char* end = nullptr;
+
+        if (key == "rate") {
+            workload.events_per_second = std::strtod(value.c_str(), &end);
+        } else if (key == "count") {
+            workload.event_count = std::strtoull(value.c_str(), &end, 10);
+        } else if (key == "min") {
+            workload.min_size = std::strtoull(value.c_str(), &end, 10);
+        } else if (key == "max") {
+            workload.max_size = std::strtoull(value.c_str(), &end, 10);
+        } else if (key == "seed") {
+            workload.seed = std::strtoull(value.c_str(), &end, 10);
+        } else if (key == "mime") {
+            // type:weight pairs separated by ';', the weight defaults to 1
+            workload.mime_mix.clear();
+            std::stringstream mimes(value);
+            std::string mime;
+            while (std::getline(mimes, mime, ';')) {
+                auto colon = mime.rfind(':');
+                double weight = 1.0;
+                if (colon != std::string::npos) {
+                    weight = std::strtod(mime.c_str() + colon + 1, nullptr);
+                    mime.resize(colon);
+                }
+                if (mime.empty() || weight <= 0) {
+                    return false;
+                }
+                workload.mime_mix.emplace_back(mime, weight);
+            }
+            continue;
+        } else {
+            return false;
+        }
+
+        if (!end || *end != '\0') {
+            return false;
+        }
+    }
+
+    return workload.events_per_second > 0 && workload.min_size > 0 &&
+           workload.min_size <= workload.max_size && !workload.mime_mix.empty();
+}
+
+bool ReplayMonitor::Initialize() {
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd_ < 0) {
+        std::cerr << "Failed to create wake eventfd" << std::endl;
+        return false;
+    }
+
+    synthetic_ = source_.rfind(kSyntheticPrefix, 0) == 0;
+    if (synthetic_) {
+        if (!ParseWorkload(source_, workload_)) {
+            std::cerr << "Invalid synthetic workload: " << source_ << std::endl;
+            return false;
+        }
+        rng_.seed(workload_.seed);
+
+        std::cout << "Replay monitor initialized: synthetic, " << workload_.events_per_second
+                  << " events/s, " << workload_.min_size << "-" << workload_.max_size
+                  << " bytes, speed " << speed_ << std::endl;
+        return true;
+    }
+
+    if (!LoadTrace(source_, trace_)) {
+        return false;
+    }
+
+    std::cout << "Replay monitor initialized: " << trace_.size() << " captures from "
+              << source_ << ", speed " << speed_ << (loop_ ? ", looping" : "") << std::endl;
+    return true;
+}
+
+void ReplayMonitor::Run() {
+    running_ = true;
+    std::cout << "Replay monitor started" << std::endl;
+
+    ClipboardDataPtr next;
+    std::chrono::steady_clock::duration delay{};
+    bool has_next = NextEvent(next, delay);
+
+    // Deadlines advance from the previous one, so slow consumers do not
+    // stretch the schedule
+    auto due = std::chrono::steady_clock::now() + delay;
+
+    while (running_) {
+        EmitPendingSelections();
+
+        if (!WaitUntil(has_next ? due : std::chrono::steady_clock::time_point::max())) {
+            continue;
+        }
+
+        if (next->selection != Selection::PRIMARY || IsPrimarySelectionEnabled()) {
+            NotifyClipboardChanged(next);
+        }
+
+        has_next = NextEvent(next, delay);
+        due += delay;
+        if (!has_next) {
+            std::cout << "Replay finished, idling until stopped" << std::endl;
+        }
+    }
+
+    running_ = false;
+    FailPendingSelections();
+
+    std::cout << "Replay monitor stopped" << std::endl;
+}
+
+void ReplayMonitor::Stop() {
+    running_ = false;
+
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+    }
+}
+
+void ReplayMonitor::SetSelection(ClipboardDataPtr content, OwnershipCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (running_) {
+            pending_selections_.push_back({std::move(content), std::move(callback)});
+            callback = nullptr;
+        }
+    }
+
+    if (callback) {
+        callback(false);
+        return;
+    }
+
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+}
+
+bool ReplayMonitor::NextEvent(ClipboardDataPtr& data, std::chrono::steady_clock::duration& delay) {
+    if (synthetic_) {
+        if (workload_.event_count != 0 && generated_ >= workload_.event_count) {
+            return false;
+        }
+
+        std::exponential_distribution<double> interval(workload_.events_per_second);
+        delay = Scale(std::chrono::microseconds(static_cast<int64_t>(interval(rng_) * 1e6)));
+        data = GenerateEvent();
+        generated_++;
+        return true;
+    }
+
+    if (trace_index_ >= trace_.size()) {
+        if (!loop_ || trace_.empty()) {
+            return false;
+        }
+        trace_index_ = 0;
+    }
+
+    const TraceEvent& event = trace_[trace_index_];
+    auto previous = trace_index_ > 0 ? trace_[trace_index_ - 1].offset : std::chrono::microseconds(0);
+    delay = Scale(std::max(event.offset - previous, std::chrono::microseconds(0)));
+    data = event.data;
+    trace_index_++;
+    return true;
+}
+
+ClipboardDataPtr ReplayMonitor::GenerateEvent() {
+    std::vector<double> weights;
+    for (const auto& entry : workload_.mime_mix) {
+        weights.push_back(entry.second);
+    }
+    std::discrete_distribution<size_t> pick_mime(weights.begin(), weights.end());
+
+    // Log-uniform, so small clips dominate like they do in practice
+    std::uniform_real_distribution<double> log_size(std::log(static_cast<double>(workload_.min_size)),
+                                                    std::log(static_cast<double>(workload_.max_size) + 1));
+    size_t size = std::clamp(static_cast<size_t>(std::exp(log_size(rng_))),
+                             workload_.min_size, workload_.max_size);
+
+    ClipboardData data;
+    data.mime_type = workload_.mime_mix[pick_mime(rng_)].first;
+    data.content_type = ContentTypeForMime(data.mime_type);
+    data.source_app = "replay";
+    data.window_title = "synthetic";
+    data.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    data.available_mime_types = OfferedMimeTypes(data.mime_type);
+
+    // Random bytes, mapped to printable lines for text formats
+    data.data.resize(size);
+    bool printable = data.content_type == ContentType::TEXT || data.content_type == ContentType::HTML;
+    for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+        uint64_t random = rng_();
+        size_t length = std::min(sizeof(uint64_t), size - i);
+        for (size_t j = 0; j < length; j++) {
+            uint8_t byte = static_cast<uint8_t>(random >> (j * 8));
+            data.data[i + j] = printable ? (byte % 80 == 0 ? '\n' : ' ' + byte % 95) : byte;
+        }
+    }
+
+    data.content_hash = ContentHasher::Hash(data.data);
+    return std::make_shared<const ClipboardData>(std::move(data));
+}
+
+std::chrono::steady_clock::duration ReplayMonitor::Scale(std::chrono::microseconds interval) const {
+    if (speed_ == 0) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval / speed_);
+}
+
+bool ReplayMonitor::WaitUntil(std::chrono::steady_clock::time_point deadline) {
+    // Returns true once the deadline passed, false when woken before it
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return true;
+        }
+
+        int timeout_ms = -1;
+        if (deadline != std::chrono::steady_clock::time_point::max()) {
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+            timeout_ms = static_cast<int>(std::min<int64_t>(remaining, 1000 * 60));
+        }
+
+        struct pollfd fds[1] = {
+            { .fd = wake_fd_, .events = POLLIN, .revents = 0 }
+        };
+
+        int ret = poll(fds, 1, timeout_ms);
+        if (ret < 0 && errno != EINTR) {
+            std::cerr << "Poll error: " << strerror(errno) << std::endl;
+            running_ = false;
+            return false;
+        }
+
+        if (ret > 0 && (fds[0].revents & POLLIN)) {
+            uint64_t count;
+            [[maybe_unused]] ssize_t drained = read(wake_fd_, &count, sizeof(count));
+            return false;
+        }
+    }
+}
+
+void ReplayMonitor::EmitPendingSelections() {
+    std::deque<PendingSelection> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_selections_);
+    }
+
+    for (auto& request : pending) {
+        request.callback(true);
+        NotifyClipboardChanged(std::move(request.content));
+    }
+}
+
+void ReplayMonitor::FailPendingSelections() {
+    std::deque<PendingSelection> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_selections_);
+    }
+
+    for (auto& request : pending) {
+        request.callback(false);
+    }
+}
+
+} // namespace clipboard
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "capture_trace.h"
+#include "clipboard_monitor.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clipboard {
+
+// Shape of a generated workload: Poisson arrivals at events_per_second,
+// payload sizes log-uniform in [min_size, max_size] and MIME types drawn by
+// weight. An event_count of 0 keeps generating until stopped.
+struct SyntheticWorkload {
+    double events_per_second = 10.0;
+    uint64_t event_count = 0;
+    size_t min_size = 16;
+    size_t max_size = 64 * 1024;
+    std::vector<std::pair<std::string, double>> mime_mix = {{"text/plain", 1.0}};
+    uint64_t seed = 1;
+};
+
+// Drives the daemon without a display server, for load tests and for
+// reproducing capture bugs. Plays back a trace written by TraceRecorder or
+// generates a synthetic workload.
+//
+// The source is a trace path or "synthetic:key=value,..." with the keys
+// rate, count, min, max, seed and mime ("text/plain:8;image/png:2"). Speed
+// scales the timing (2 plays twice as fast, 0 emits without delays); traces
+// can loop. Replayed captures keep their recorded metadata and are shared,
+// not copied, on every loop.
+class ReplayMonitor : public IClipboardMonitor {
+public:
+    ReplayMonitor(std::string source, double speed, bool loop);
+    ~ReplayMonitor() override;
+
+    bool Initialize() override;
+    void Run() override;
+    void Stop() override;
+    bool IsRunning() const override { return running_; }
+
+    // Echoes the content back as the next capture, as a compositor would
+    void SetSelection(ClipboardDataPtr content, OwnershipCallback callback) override;
+
+    static bool ParseWorkload(const std::string& spec, SyntheticWorkload& workload);
+
+private:
+    struct PendingSelection {
+        ClipboardDataPtr content;
+        OwnershipCallback callback;
+    };
+
+    bool NextEvent(ClipboardDataPtr& data, std::chrono::steady_clock::duration& delay);
+    ClipboardDataPtr GenerateEvent();
+    std::chrono::steady_clock::duration Scale(std::chrono::microseconds interval) const;
+    bool WaitUntil(std::chrono::steady_clock::time_point deadline);
+    void EmitPendingSelections();
+    void FailPendingSelections();
+
+    const std::string source_;
+    const double speed_;
+    const bool loop_;
+    bool synthetic_;
+
+    SyntheticWorkload workload_;
+    std::mt19937_64 rng_;
+    uint64_t generated_;
+
+    std::vector<TraceEvent> trace_;
+    size_t trace_index_;
+
+    std::atomic<bool> running_;
+
+    // Wakes Run() for Stop() and queued selections
+    int wake_fd_;
+    std::mutex pending_mutex_;
+    std::deque<PendingSelection> pending_selections_;
+};
+
+} // namespace clipboard
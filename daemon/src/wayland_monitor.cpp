@@ -1,15 +1,23 @@
 #include "wayland_monitor.h"
 #include "wlr-data-control-unstable-v1-client-protocol.h"
+#include <algorithm>
+#include <iterator>
 #include <iostream>
 #include <cstring>
+#include <stdexcept>
 #include <unistd.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/eventfd.h>
 #include <cerrno>
 #include <chrono>
 
 namespace clipboard {
 
+// Run() polls the display fd, then the wake fd, then one fd per transfer
+// followed by one per source send
+static constexpr size_t kFirstTransferPollIndex = 2;
+
 WaylandMonitor::WaylandMonitor()
     : display_(nullptr)
     , registry_(nullptr)
@@ -19,12 +27,31 @@ WaylandMonitor::WaylandMonitor()
     , current_offer_(nullptr)
     , pending_offer_(nullptr)
     , running_(false)
+    , primary_offer_(nullptr)
+    , primary_pending_(false)
+    , wake_fd_(-1)
 {
 }
 
 WaylandMonitor::~WaylandMonitor() {
     Stop();
+    CancelTransfers();
+    CancelSends();
+    FailPendingFormats();
+    FailPendingSelections();
     
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+    }
+    for (auto& owned : owned_sources_) {
+        zwlr_data_control_source_v1_destroy(owned.source);
+    }
+    if (current_offer_) {
+        zwlr_data_control_offer_v1_destroy(current_offer_);
+    }
+    if (primary_offer_) {
+        zwlr_data_control_offer_v1_destroy(primary_offer_);
+    }
     if (data_control_device_) {
         zwlr_data_control_device_v1_destroy(data_control_device_);
     }
@@ -50,6 +77,12 @@ bool WaylandMonitor::Initialize() {
         return false;
     }
     
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd_ < 0) {
+        std::cerr << "Failed to create wake eventfd" << std::endl;
+        return false;
+    }
+    
     // Get registry
     registry_ = wl_display_get_registry(display_);
     if (!registry_) {
@@ -112,6 +145,7 @@ void WaylandMonitor::Run() {
     std::cout << "Wayland monitor started" << std::endl;
     
     int fd = wl_display_get_fd(display_);
+    std::vector<struct pollfd> fds;
     
     while (running_) {
         // Dispatch pending events first
@@ -121,36 +155,268 @@ void WaylandMonitor::Run() {
         
         wl_display_flush(display_);
         
-        // Poll with timeout so we can check running_ flag
-        struct pollfd pfd = {
-            .fd = fd,
-            .events = POLLIN,
-            .revents = 0
-        };
+        // Display fd first, then the wake fd, every in-flight offer transfer
+        // and every pipe owned content is being written to
+        fds.clear();
+        fds.push_back({ .fd = fd, .events = POLLIN, .revents = 0 });
+        fds.push_back({ .fd = wake_fd_, .events = POLLIN, .revents = 0 });
+        for (const auto& transfer : transfers_) {
+            fds.push_back({ .fd = transfer.fd, .events = POLLIN, .revents = 0 });
+        }
+        for (const auto& send : sends_) {
+            fds.push_back({ .fd = send.fd, .events = POLLOUT, .revents = 0 });
+        }
         
-        int ret = poll(&pfd, 1, 100); // 100ms timeout
+        // Timeout so we can check running_ flag and expire transfers
+        int ret = poll(fds.data(), fds.size(), NextPollTimeout());
         
-        if (ret > 0) {
+        if (ret > 0 && (fds[0].revents & POLLIN)) {
             wl_display_read_events(display_);
-            wl_display_dispatch_pending(display_);
-        } else if (ret == 0) {
-            // Timeout, cancel read
-            wl_display_cancel_read(display_);
         } else {
-            // Error
             wl_display_cancel_read(display_);
+        }
+        
+        if (ret < 0) {
             if (errno != EINTR) {
                 std::cerr << "Poll error: " << strerror(errno) << std::endl;
                 break;
             }
+            continue;
+        }
+        
+        if (fds[1].revents & POLLIN) {
+            uint64_t count;
+            [[maybe_unused]] ssize_t drained = read(wake_fd_, &count, sizeof(count));
+        }
+        
+        // Sends first, ServiceTransfers() shifts the transfer indices
+        ServiceSends(fds, kFirstTransferPollIndex + transfers_.size());
+        ServiceTransfers(fds);
+        wl_display_dispatch_pending(display_);
+        StartPendingFormats();
+        StartPendingSelections();
+        
+        if (primary_pending_ && std::chrono::steady_clock::now() >= primary_deadline_) {
+            StartPrimaryTransfer();
         }
     }
     
+    // Nobody is left to complete outstanding requests
+    running_ = false;
+    CancelTransfers();
+    CancelSends();
+    FailPendingFormats();
+    FailPendingSelections();
+    
     std::cout << "Wayland monitor stopped" << std::endl;
 }
 
 void WaylandMonitor::Stop() {
     running_ = false;
+    
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+    }
+}
+
+void WaylandMonitor::RequestFormat(const std::string& mime_type, FormatCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        // Run() sets running_ to false before failing the queue, so a request
+        // queued here is always completed
+        if (running_) {
+            pending_formats_.push_back({mime_type, std::move(callback)});
+            callback = nullptr;
+        }
+    }
+    
+    if (callback) {
+        callback(nullptr);
+        return;
+    }
+    
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+}
+
+void WaylandMonitor::SetSelection(ClipboardDataPtr content, OwnershipCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (running_) {
+            pending_selections_.push_back({std::move(content), std::move(callback)});
+            callback = nullptr;
+        }
+    }
+    
+    if (callback) {
+        callback(false);
+        return;
+    }
+    
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+}
+
+void WaylandMonitor::StartPendingFormats() {
+    std::vector<PendingFormat> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_formats_);
+    }
+    
+    for (auto& request : pending) {
+        bool offered = current_offer_ &&
+            std::find(current_offer_mime_types_.begin(), current_offer_mime_types_.end(),
+                      request.mime_type) != current_offer_mime_types_.end();
+        
+        if (!offered) {
+            std::cout << "   ⏭️  Format not offered: " << request.mime_type << std::endl;
+            request.callback(nullptr);
+            continue;
+        }
+        
+        // Completed by FinishTransfer(), or failed when the selection changes
+        FormatCallback callback = request.callback;
+        if (!StartTransfer(current_offer_, request.mime_type, Selection::CLIPBOARD,
+                           std::move(request.callback))) {
+            callback(nullptr);
+        }
+    }
+}
+
+void WaylandMonitor::FailPendingFormats() {
+    std::vector<PendingFormat> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_formats_);
+    }
+    
+    for (auto& request : pending) {
+        request.callback(nullptr);
+    }
+}
+
+void WaylandMonitor::StartPendingSelections() {
+    std::vector<PendingSelection> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_selections_);
+    }
+    
+    static const zwlr_data_control_source_v1_listener source_listener = {
+        .send = data_source_send,
+        .cancelled = data_source_cancelled
+    };
+    
+    for (auto& request : pending) {
+        auto* source = zwlr_data_control_manager_v1_create_data_source(data_control_manager_);
+        if (!source) {
+            request.callback(false);
+            continue;
+        }
+        
+        zwlr_data_control_source_v1_add_listener(source, &source_listener, this);
+        for (const auto& mime_type : request.content->available_mime_types) {
+            zwlr_data_control_source_v1_offer(source, mime_type.c_str());
+        }
+        
+        // The previous owned source is cancelled by the compositor
+        zwlr_data_control_device_v1_set_selection(data_control_device_, source);
+        wl_display_flush(display_);
+        owned_sources_.push_back({source, std::move(request.content)});
+        
+        std::cout << "📌 Took clipboard selection (" << owned_sources_.back().content->data.size()
+                  << " bytes)" << std::endl;
+        request.callback(true);
+    }
+}
+
+void WaylandMonitor::FailPendingSelections() {
+    std::vector<PendingSelection> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_selections_);
+    }
+    
+    for (auto& request : pending) {
+        request.callback(false);
+    }
+}
+
+bool WaylandMonitor::IsOwnSelection() const {
+    // Offers do not identify their source; ours is the newest live source
+    // offering exactly the same formats
+    if (owned_sources_.empty()) {
+        return false;
+    }
+    
+    const auto& offered = owned_sources_.back().content->available_mime_types;
+    return std::is_permutation(current_offer_mime_types_.begin(), current_offer_mime_types_.end(),
+                               offered.begin(), offered.end());
+}
+
+bool WaylandMonitor::WriteSend(SourceSend& send) {
+    // Write what the pipe takes; returns true once everything was written
+    const auto& data = send.content->data;
+    
+    while (send.offset < data.size()) {
+        ssize_t written = write(send.fd, data.data() + send.offset, data.size() - send.offset);
+        
+        if (written > 0) {
+            send.offset += written;
+            continue;
+        }
+        
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return false;
+        }
+        
+        throw std::runtime_error(std::string("Failed to write selection: ") + strerror(errno));
+    }
+    
+    return true;
+}
+
+void WaylandMonitor::ServiceSends(const std::vector<struct pollfd>& fds, size_t first_index) {
+    auto now = std::chrono::steady_clock::now();
+    
+    for (size_t i = sends_.size(); i-- > 0;) {
+        SourceSend& send = sends_[i];
+        size_t poll_index = first_index + i;
+        bool done = false;
+        
+        try {
+            if (poll_index < fds.size() && fds[poll_index].revents != 0) {
+                done = WriteSend(send);
+            }
+            
+            if (!done && now >= send.deadline) {
+                throw std::runtime_error("Timeout writing selection");
+            }
+        } catch (const std::exception& e) {
+            // The reader gave up; the selection itself is unaffected
+            std::cerr << "   ⚠️  " << e.what() << " (" << send.offset << " of "
+                      << send.content->data.size() << " bytes)" << std::endl;
+            done = true;
+        }
+        
+        if (done) {
+            close(send.fd);
+            sends_.erase(sends_.begin() + i);
+        }
+    }
+}
+
+void WaylandMonitor::CancelSends() {
+    for (auto& send : sends_) {
+        close(send.fd);
+    }
+    sends_.clear();
 }
 
 void WaylandMonitor::HandleSelection(zwlr_data_control_offer_v1* offer) {
@@ -168,57 +434,54 @@ void WaylandMonitor::HandleSelection(zwlr_data_control_offer_v1* offer) {
     }
     
     // Ignorar MIME types de metadata
-    if (current_mime_type_ == "SAVE_TARGETS" || 
-        current_mime_type_ == "TARGETS" ||
-        current_mime_type_ == "MULTIPLE" ||
-        current_mime_type_ == "TIMESTAMP" ||
-        current_mime_type_.find("chromium/") == 0) {
+    if (IsMetadataMimeType(current_mime_type_)) {
         std::cout << "   ⏭️  Ignoring metadata MIME type: " << current_mime_type_ << std::endl;
         return;
     }
     
-    std::string mime_type = current_mime_type_;
+    // Data arrives asynchronously through the Run() poll loop
+    if (!StartTransfer(offer, current_mime_type_, Selection::CLIPBOARD)) {
+        std::cerr << "   ❌ Error starting clipboard transfer" << std::endl;
+    }
+}
+
+void WaylandMonitor::HandlePrimarySelection() {
+    // Only the selection as it was when the drag ended is worth a transfer,
+    // so every change just restarts the quiet period
+    primary_mime_type_ = current_mime_type_;
+    primary_offer_mime_types_ = available_mime_types_;
+    primary_pending_ = !primary_mime_type_.empty() && !IsMetadataMimeType(primary_mime_type_);
+    primary_deadline_ = std::chrono::steady_clock::now() + kPrimarySettleDelay;
+}
+
+void WaylandMonitor::StartPrimaryTransfer() {
+    primary_pending_ = false;
+    
+    if (!primary_offer_ || !IsPrimarySelectionEnabled()) {
+        return;
+    }
+    
+    std::cout << "🖱️  Primary selection settled (Wayland)" << std::endl;
     
-    try {
-        auto data = ReadOfferData(offer, mime_type);
-        
-        // Ignorar si no hay datos
-        if (data.data.empty()) {
-            std::cout << "   ⚠️  No data read, ignoring" << std::endl;
-            return;
-        }
-        
-        std::cout << "   ✅ Read " << data.data.size() << " bytes" << std::endl;
-        
-        if (OnClipboardChanged) {
-            OnClipboardChanged(data);
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "   ❌ Error reading clipboard: " << e.what() << std::endl;
+    if (!StartTransfer(primary_offer_, primary_mime_type_, Selection::PRIMARY)) {
+        std::cerr << "   ❌ Error starting primary selection transfer" << std::endl;
     }
 }
 
-ClipboardData WaylandMonitor::ReadOfferData(
+bool WaylandMonitor::StartTransfer(
     zwlr_data_control_offer_v1* offer,
-    const std::string& mime_type)
+    const std::string& mime_type,
+    Selection selection,
+    FormatCallback callback)
 {
-    ClipboardData result;
-    result.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count();
-    result.source_app = "wayland";
-    result.window_title = "wayland";
-    result.mime_type = mime_type;
-    
     std::cout << "  Reading data for MIME: " << mime_type << std::endl;
     
-    // Create pipe
+    // Create pipe, read end non-blocking so it can live in the poll set
     int pipe_fds[2];
-    if (pipe(pipe_fds) == -1) {
-        throw std::runtime_error("Failed to create pipe");
+    if (pipe2(pipe_fds, O_CLOEXEC) == -1) {
+        return false;
     }
     
-    // Make read end non-blocking
     int flags = fcntl(pipe_fds[0], F_GETFL, 0);
     fcntl(pipe_fds[0], F_SETFL, flags | O_NONBLOCK);
     
@@ -229,44 +492,175 @@ ClipboardData WaylandMonitor::ReadOfferData(
     // Flush to send the request
     wl_display_flush(display_);
     
-    // Wait a bit for data to arrive
-    usleep(5000); // 5ms
+    Transfer transfer;
+    transfer.fd = pipe_fds[0];
+    transfer.mime_type = mime_type;
+    transfer.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    transfer.started = std::chrono::steady_clock::now();
+    transfer.deadline = transfer.started + kTransferTimeout;
+    transfer.selection = selection;
+    transfer.callback = std::move(callback);
+    transfers_.push_back(std::move(transfer));
     
-    // Read data
-    char buffer[4096];
-    ssize_t bytes_read;
-    size_t total_bytes = 0;
+    return true;
+}
+
+bool WaylandMonitor::ReadTransfer(Transfer& transfer) {
+    // Drain what is available; returns true once the source closed the pipe
+    uint8_t buffer[65536];
     
-    // Try reading multiple times
-    for (int attempts = 0; attempts < 10; attempts++) {
-        while ((bytes_read = read(pipe_fds[0], buffer, sizeof(buffer))) > 0) {
-            result.data.insert(result.data.end(), buffer, buffer + bytes_read);
-            total_bytes += bytes_read;
+    while (true) {
+        ssize_t bytes_read = read(transfer.fd, buffer, sizeof(buffer));
+        
+        if (bytes_read > 0) {
+            if (transfer.data.size() + bytes_read > kMaxTransferBytes) {
+                throw std::runtime_error("Clipboard data exceeds " +
+                                         std::to_string(kMaxTransferBytes) + " bytes");
+            }
+            transfer.data.insert(transfer.data.end(), buffer, buffer + bytes_read);
+            transfer.hasher.Update(buffer, bytes_read);
+            continue;
         }
         
-        if (total_bytes > 0 || bytes_read == 0) {
-            break; // Got data or EOF
+        if (bytes_read == 0) {
+            return true;
         }
         
-        // Dispatch events to process the transfer
-        wl_display_dispatch_pending(display_);
-        usleep(5000); // 5ms
+        if (errno == EINTR) {
+            continue;
+        }
+        
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            throw std::runtime_error(std::string("Failed to read offer: ") + strerror(errno));
+        }
+        
+        return false;
+    }
+}
+
+void WaylandMonitor::FinishTransfer(Transfer& transfer) {
+    ClipboardData result;
+    result.timestamp = transfer.timestamp;
+    result.source_app = "wayland";
+    result.window_title = "wayland";
+    result.mime_type = transfer.mime_type;
+    result.content_type = ContentTypeForMime(result.mime_type);
+    result.content_hash = transfer.hasher.Finish();
+    result.selection = transfer.selection;
+    result.available_mime_types = transfer.selection == Selection::PRIMARY
+        ? primary_offer_mime_types_
+        : current_offer_mime_types_;
+    result.data = std::move(transfer.data);
+    
+    std::cout << "  Read " << result.data.size() << " bytes" << std::endl;
+    
+    // Ignorar si no hay datos
+    if (result.data.empty()) {
+        std::cout << "   ⚠️  No data read, ignoring" << std::endl;
+        if (transfer.callback) {
+            transfer.callback(nullptr);
+        }
+        return;
     }
     
-    close(pipe_fds[0]);
+    // On-demand formats go to the requester only, they are not a new capture
+    if (transfer.callback) {
+        transfer.callback(std::make_shared<const ClipboardData>(std::move(result)));
+        return;
+    }
+    
+    NotifyClipboardChanged(std::move(result));
+}
+
+void WaylandMonitor::ServiceTransfers(const std::vector<struct pollfd>& fds) {
+    auto now = std::chrono::steady_clock::now();
+    
+    // fds[i + kFirstTransferPollIndex] belongs to transfers_[i]; dispatch has
+    // not run since poll()
+    for (size_t i = transfers_.size(); i-- > 0;) {
+        Transfer& transfer = transfers_[i];
+        size_t poll_index = i + kFirstTransferPollIndex;
+        bool done = false;
+        bool failed = false;
+        
+        try {
+            if (poll_index < fds.size() && fds[poll_index].revents != 0) {
+                done = ReadTransfer(transfer);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "   ❌ Error reading clipboard: " << e.what() << std::endl;
+            failed = true;
+        }
+        
+        if (!done && !failed && now >= transfer.deadline) {
+            std::cerr << "   ⚠️  Timeout reading clipboard (" << transfer.mime_type
+                      << ", " << transfer.data.size() << " bytes so far)" << std::endl;
+            failed = true;
+        }
+        
+        if (!done && !failed) {
+            continue;
+        }
+        
+        close(transfer.fd);
+        Transfer finished = std::move(transfer);
+        transfers_.erase(transfers_.begin() + i);
+        
+        RecordRead(finished.mime_type, finished.data.size(), now - finished.started, done);
+        
+        if (done) {
+            FinishTransfer(finished);
+        } else if (finished.callback) {
+            finished.callback(nullptr);
+        }
+    }
+}
+
+void WaylandMonitor::CancelTransfers() {
+    CancelTransfers(Selection::CLIPBOARD);
+    CancelTransfers(Selection::PRIMARY);
+}
+
+void WaylandMonitor::CancelTransfers(Selection selection) {
+    std::vector<Transfer> cancelled;
+    auto split = std::stable_partition(transfers_.begin(), transfers_.end(),
+        [selection](const Transfer& transfer) { return transfer.selection != selection; });
+    cancelled.assign(std::make_move_iterator(split), std::make_move_iterator(transfers_.end()));
+    transfers_.erase(split, transfers_.end());
+    
+    for (auto& transfer : cancelled) {
+        close(transfer.fd);
+        if (transfer.callback) {
+            transfer.callback(nullptr);
+        }
+    }
+}
+
+int WaylandMonitor::NextPollTimeout() const {
+    int timeout_ms = 100;
+    auto now = std::chrono::steady_clock::now();
+    
+    for (const auto& transfer : transfers_) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            transfer.deadline - now).count();
+        timeout_ms = std::min<int>(timeout_ms, std::max<int64_t>(remaining, 0));
+    }
     
-    std::cout << "  Read " << total_bytes << " bytes" << std::endl;
+    for (const auto& send : sends_) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            send.deadline - now).count();
+        timeout_ms = std::min<int>(timeout_ms, std::max<int64_t>(remaining, 0));
+    }
     
-    // Determine content type
-    if (mime_type.find("text/") == 0) {
-        result.content_type = ContentType::TEXT;
-    } else if (mime_type.find("image/") == 0) {
-        result.content_type = ContentType::IMAGE;
-    } else {
-        result.content_type = ContentType::UNKNOWN;
+    if (primary_pending_) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            primary_deadline_ - now).count();
+        timeout_ms = std::min<int>(timeout_ms, std::max<int64_t>(remaining, 0));
     }
     
-    return result;
+    return timeout_ms;
 }
 
 // Static callbacks
@@ -324,11 +718,29 @@ void WaylandMonitor::data_device_selection(
     zwlr_data_control_offer_v1* offer)
 {
     auto* monitor = static_cast<WaylandMonitor*>(data);
+    
+    // The previous selection offer is no longer valid, and neither are the
+    // transfers still reading from it
+    if (monitor->current_offer_ != offer) {
+        monitor->CancelTransfers(Selection::CLIPBOARD);
+        if (monitor->current_offer_) {
+            zwlr_data_control_offer_v1_destroy(monitor->current_offer_);
+        }
+    }
     monitor->current_offer_ = offer;
+    monitor->current_offer_mime_types_ = offer ? monitor->available_mime_types_
+                                               : std::vector<std::string>();
     
     // At this point, all MIME types have been offered
     // So current_mime_type_ should be set correctly
     
+    // Our own selection is already in memory, no need to read it back
+    if (offer && monitor->IsOwnSelection()) {
+        std::cout << "📋 Clipboard changed (Wayland, owned by daemon)" << std::endl;
+        monitor->NotifyClipboardChanged(monitor->owned_sources_.back().content);
+        return;
+    }
+    
     if (offer) {
         monitor->HandleSelection(offer);
     }
@@ -342,12 +754,31 @@ void WaylandMonitor::data_device_finished(
 }
 
 void WaylandMonitor::data_device_primary_selection(
-    [[maybe_unused]] void* data,
+    void* data,
     [[maybe_unused]] zwlr_data_control_device_v1* device,
-    [[maybe_unused]] zwlr_data_control_offer_v1* offer)
+    zwlr_data_control_offer_v1* offer)
 {
-    // Primary selection (middle-click paste), ignore
-    // Solo queremos el clipboard normal (Ctrl+C / Ctrl+Shift+C)
+    auto* monitor = static_cast<WaylandMonitor*>(data);
+    
+    if (monitor->primary_offer_ != offer) {
+        monitor->CancelTransfers(Selection::PRIMARY);
+        if (monitor->primary_offer_) {
+            zwlr_data_control_offer_v1_destroy(monitor->primary_offer_);
+        }
+    }
+    monitor->primary_offer_ = offer;
+    monitor->primary_pending_ = false;
+    
+    // Primary selection (middle-click paste) is only captured on request
+    if (offer && !monitor->IsPrimarySelectionEnabled()) {
+        zwlr_data_control_offer_v1_destroy(offer);
+        monitor->primary_offer_ = nullptr;
+        return;
+    }
+    
+    if (offer) {
+        monitor->HandlePrimarySelection();
+    }
 }
 
 void WaylandMonitor::data_offer_offer(
@@ -361,15 +792,14 @@ void WaylandMonitor::data_offer_offer(
     std::cout << "   📎 MIME offered: " << mime_str << std::endl;
     
     // Ignorar MIME types de metadata/control
-    if (mime_str == "SAVE_TARGETS" || 
-        mime_str == "TARGETS" ||
-        mime_str == "MULTIPLE" ||
-        mime_str == "TIMESTAMP" ||
-        mime_str.find("chromium/") == 0) {
+    if (IsMetadataMimeType(mime_str)) {
         std::cout << "      ⏭️  Skipping metadata" << std::endl;
         return; // Skip metadata
     }
     
+    // Every representation stays fetchable on demand
+    monitor->available_mime_types_.push_back(mime_str);
+    
     // Priority: image > text/plain > UTF8_STRING > other text > other
     // If we already have an image MIME type, keep it
     if (monitor->current_mime_type_.find("image/") == 0) {
@@ -411,4 +841,47 @@ void WaylandMonitor::data_offer_offer(
     }
 }
 
+void WaylandMonitor::data_source_send(
+    void* data,
+    zwlr_data_control_source_v1* source,
+    [[maybe_unused]] const char* mime_type,
+    int32_t fd)
+{
+    auto* monitor = static_cast<WaylandMonitor*>(data);
+    
+    auto it = std::find_if(monitor->owned_sources_.begin(), monitor->owned_sources_.end(),
+        [source](const OwnedSource& owned) { return owned.source == source; });
+    if (it == monitor->owned_sources_.end()) {
+        close(fd);
+        return;
+    }
+    
+    // Every offered format is the same bytes; written as the reader drains
+    // the pipe, so a slow reader never blocks the monitor
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    
+    SourceSend send;
+    send.fd = fd;
+    send.content = it->content;
+    send.offset = 0;
+    send.deadline = std::chrono::steady_clock::now() + kTransferTimeout;
+    monitor->sends_.push_back(std::move(send));
+}
+
+void WaylandMonitor::data_source_cancelled(
+    void* data,
+    zwlr_data_control_source_v1* source)
+{
+    auto* monitor = static_cast<WaylandMonitor*>(data);
+    
+    // Another client took the selection; sends in progress still finish
+    auto it = std::find_if(monitor->owned_sources_.begin(), monitor->owned_sources_.end(),
+        [source](const OwnedSource& owned) { return owned.source == source; });
+    if (it != monitor->owned_sources_.end()) {
+        monitor->owned_sources_.erase(it);
+    }
+    zwlr_data_control_source_v1_destroy(source);
+}
+
 } // namespace clipboard
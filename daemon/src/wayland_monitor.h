@@ -2,8 +2,12 @@
 
 #include "clipboard_monitor.h"
 #include <wayland-client.h>
+#include <poll.h>
 #include <atomic>
+#include <chrono>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 // Forward declarations
 struct zwlr_data_control_manager_v1;
@@ -13,6 +17,10 @@ struct zwlr_data_control_offer_v1;
 
 namespace clipboard {
 
+// Limits for a single offer transfer; sources that exceed them are dropped
+constexpr std::chrono::milliseconds kTransferTimeout(5000);
+constexpr size_t kMaxTransferBytes = 256 * 1024 * 1024;
+
 class WaylandMonitor : public IClipboardMonitor {
 public:
     WaylandMonitor();
@@ -22,10 +30,74 @@ public:
     void Run() override;
     void Stop() override;
     bool IsRunning() const override { return running_; }
+    
+    // Alternates are received from the kept selection offer on the monitor thread
+    void RequestFormat(const std::string& mime_type, FormatCallback callback) override;
+    
+    // Takes the selection with a data source whose content is written to
+    // readers from the Run() poll loop
+    void SetSelection(ClipboardDataPtr content, OwnershipCallback callback) override;
 
 private:
+    // Offer data being read from the source's pipe alongside the display fd.
+    // Transfers with a callback are on-demand format requests, the others
+    // are selection captures.
+    struct Transfer {
+        int fd;
+        std::string mime_type;
+        std::vector<uint8_t> data;
+        ContentHasher hasher;
+        int64_t timestamp;
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point deadline;
+        Selection selection;
+        FormatCallback callback;
+    };
+    
+    struct PendingFormat {
+        std::string mime_type;
+        FormatCallback callback;
+    };
+    
+    struct PendingSelection {
+        ClipboardDataPtr content;
+        OwnershipCallback callback;
+    };
+    
+    // Data source set as the selection by the daemon, alive until the
+    // compositor cancels it
+    struct OwnedSource {
+        zwlr_data_control_source_v1* source;
+        ClipboardDataPtr content;
+    };
+    
+    // Owned content being written into a reader's pipe
+    struct SourceSend {
+        int fd;
+        ClipboardDataPtr content;
+        size_t offset;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    
     void HandleSelection(zwlr_data_control_offer_v1* offer);
-    ClipboardData ReadOfferData(zwlr_data_control_offer_v1* offer, const std::string& mime_type);
+    void HandlePrimarySelection();
+    void StartPrimaryTransfer();
+    bool StartTransfer(zwlr_data_control_offer_v1* offer, const std::string& mime_type,
+                       Selection selection, FormatCallback callback = nullptr);
+    bool ReadTransfer(Transfer& transfer);
+    void FinishTransfer(Transfer& transfer);
+    void ServiceTransfers(const std::vector<struct pollfd>& fds);
+    void CancelTransfers();
+    void CancelTransfers(Selection selection);
+    void StartPendingFormats();
+    void FailPendingFormats();
+    void StartPendingSelections();
+    void FailPendingSelections();
+    bool IsOwnSelection() const;
+    bool WriteSend(SourceSend& send);
+    void ServiceSends(const std::vector<struct pollfd>& fds, size_t first_index);
+    void CancelSends();
+    int NextPollTimeout() const;
     
     wl_display* display_;
     wl_registry* registry_;
@@ -36,9 +108,31 @@ private:
     zwlr_data_control_offer_v1* pending_offer_;
     
     std::atomic<bool> running_;
+    std::vector<Transfer> transfers_;
     std::string current_mime_type_;
     std::vector<std::string> available_mime_types_;
     
+    // MIME types of current_offer_, which stays alive until it is replaced
+    std::vector<std::string> current_offer_mime_types_;
+    
+    // Latest primary selection offer, transferred once it stopped changing
+    // for kPrimarySettleDelay
+    zwlr_data_control_offer_v1* primary_offer_;
+    std::string primary_mime_type_;
+    std::vector<std::string> primary_offer_mime_types_;
+    bool primary_pending_;
+    std::chrono::steady_clock::time_point primary_deadline_;
+    
+    // Newest last; only the newest one can still be the selection
+    std::vector<OwnedSource> owned_sources_;
+    std::vector<SourceSend> sends_;
+    
+    // Wakes Run() for Stop() and queued requests
+    int wake_fd_;
+    std::mutex pending_mutex_;
+    std::vector<PendingFormat> pending_formats_;
+    std::vector<PendingSelection> pending_selections_;
+    
     // Static callbacks for Wayland
     static void registry_global(void* data, wl_registry* registry,
                                uint32_t name, const char* interface,
@@ -61,6 +155,13 @@ private:
     static void data_offer_offer(void* data,
                                 zwlr_data_control_offer_v1* offer,
                                 const char* mime_type);
+    
+    static void data_source_send(void* data,
+                                 zwlr_data_control_source_v1* source,
+                                 const char* mime_type,
+                                 int32_t fd);
+    static void data_source_cancelled(void* data,
+                                      zwlr_data_control_source_v1* source);
 };
 
 } // namespace clipboard
@@ -1,7 +1,14 @@
 #include "x11_monitor.h"
+#include <algorithm>
 #include <iostream>
+#include <sstream>
+#include <cstdlib>
 #include <cstring>
+#include <cerrno>
 #include <chrono>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 namespace clipboard {
 
@@ -19,6 +26,20 @@ static int x11_error_handler(Display* display, XErrorEvent* error) {
     return 0;
 }
 
+// Mirrors the Wayland preference: images, then plain text, then rich formats
+static const std::vector<std::string> kDefaultTargetPriority = {
+    "image/png",
+    "image/*",
+    "text/plain;charset=utf-8",
+    "UTF8_STRING",
+    "text/plain",
+    "STRING",
+    "TEXT",
+    "text/html",
+    "text/uri-list",
+    "text/*"
+};
+
 X11Monitor::X11Monitor()
     : display_(nullptr)
     , window_(0)
@@ -27,13 +48,45 @@ X11Monitor::X11Monitor()
     , targets_atom_(0)
     , text_atom_(0)
     , png_atom_(0)
+    , incr_atom_(0)
+    , timestamp_atom_(0)
+    , ownership_time_atom_(0)
+    , selection_time_(CurrentTime)
+    , primary_pending_(false)
+    , primary_time_(CurrentTime)
     , running_(false)
     , xfixes_event_base_(0)
+    , owned_time_(CurrentTime)
+    , wake_fd_(-1)
 {
+    target_priority_ = kDefaultTargetPriority;
+    
+    if (const char* priority = std::getenv("CLIPBOARD_TARGET_PRIORITY")) {
+        std::vector<std::string> parsed;
+        std::stringstream stream(priority);
+        std::string entry;
+        while (std::getline(stream, entry, ',')) {
+            if (!entry.empty()) {
+                parsed.push_back(entry);
+            }
+        }
+        SetTargetPriority(std::move(parsed));
+    }
+}
+
+void X11Monitor::SetTargetPriority(std::vector<std::string> priority) {
+    if (!priority.empty()) {
+        target_priority_ = std::move(priority);
+    }
 }
 
 X11Monitor::~X11Monitor() {
     Stop();
+    FailPendingFormats();
+    FailPendingSelections();
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+    }
     if (window_ && display_) {
         XDestroyWindow(display_, window_);
     }
@@ -79,12 +132,29 @@ bool X11Monitor::Initialize() {
         return false;
     }
     
+    // Wakes Run() out of poll() on Stop() and for queued requests
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd_ < 0) {
+        std::cerr << "Failed to create wake eventfd" << std::endl;
+        XDestroyWindow(display_, window_);
+        XCloseDisplay(display_);
+        window_ = 0;
+        display_ = nullptr;
+        return false;
+    }
+    
     // Get atoms
     clipboard_atom_ = XInternAtom(display_, "CLIPBOARD", False);
     utf8_string_atom_ = XInternAtom(display_, "UTF8_STRING", False);
     targets_atom_ = XInternAtom(display_, "TARGETS", False);
     text_atom_ = XInternAtom(display_, "TEXT", False);
     png_atom_ = XInternAtom(display_, "image/png", False);
+    incr_atom_ = XInternAtom(display_, "INCR", False);
+    timestamp_atom_ = XInternAtom(display_, "TIMESTAMP", False);
+    ownership_time_atom_ = XInternAtom(display_, "_CLIPBOARD_DAEMON_OWNERSHIP_TIME", False);
+    
+    // INCR transfers are driven by PropertyNotify on our window
+    XSelectInput(display_, window_, PropertyChangeMask);
     
     // Register for clipboard change notifications
     XFixesSelectSelectionInput(
@@ -94,6 +164,14 @@ bool X11Monitor::Initialize() {
         XFixesSetSelectionOwnerNotifyMask
     );
     
+    // PRIMARY changes are only acted on while primary capture is enabled
+    XFixesSelectSelectionInput(
+        display_,
+        window_,
+        XA_PRIMARY,
+        XFixesSetSelectionOwnerNotifyMask
+    );
+    
     std::cout << "X11 monitor initialized successfully" << std::endl;
     return true;
 }
@@ -107,127 +185,760 @@ void X11Monitor::Run() {
     running_ = true;
     std::cout << "X11 monitor started" << std::endl;
     
+    int x11_fd = ConnectionNumber(display_);
+    
     while (running_) {
-        // Check for events (with timeout)
+        // Handle everything Xlib has buffered (XPending also flushes requests)
         while (XPending(display_) > 0) {
             XEvent event;
             XNextEvent(display_, &event);
-            
-            if (event.type == xfixes_event_base_ + XFixesSelectionNotify) {
-                auto* selection_event = reinterpret_cast<XFixesSelectionNotifyEvent*>(&event);
-                HandleSelectionNotify(*selection_event);
+            HandleEvent(event);
+        }
+        
+        // On-demand formats share the single conversion slot with captures
+        // and go before a settled primary selection
+        if (!request_.active) {
+            StartPendingFormat();
+        }
+        
+        if (!acquiring_.callback) {
+            StartPendingSelection();
+        }
+        
+        if (!request_.active && primary_pending_ &&
+            std::chrono::steady_clock::now() >= primary_deadline_) {
+            primary_pending_ = false;
+            if (IsPrimarySelectionEnabled()) {
+                std::cout << "🖱️  Primary selection settled" << std::endl;
+                StartSelectionRequest(XA_PRIMARY, primary_time_);
             }
         }
         
-        // Small sleep to avoid busy waiting
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // Sleep until the X server, Stop() or a queued request has something for us
+        struct pollfd fds[2] = {
+            { .fd = x11_fd, .events = POLLIN, .revents = 0 },
+            { .fd = wake_fd_, .events = POLLIN, .revents = 0 }
+        };
+        
+        int ret = poll(fds, 2, NextPollTimeout());
+        
+        if (ret < 0 && errno != EINTR) {
+            std::cerr << "Poll error: " << strerror(errno) << std::endl;
+            break;
+        }
+        
+        if (ret > 0 && (fds[1].revents & POLLIN)) {
+            uint64_t count;
+            [[maybe_unused]] ssize_t drained = read(wake_fd_, &count, sizeof(count));
+        }
+        
+        if (request_.active && std::chrono::steady_clock::now() >= request_.deadline) {
+            AbortRequest("Timeout waiting for clipboard data");
+        }
+        
+        ExpireIncrementalSends();
     }
     
+    // Nobody is left to complete outstanding requests
+    running_ = false;
+    if (request_.active && request_.callback) {
+        AbortRequest("Monitor stopped");
+    }
+    FailPendingFormats();
+    FailPendingSelections();
+    
     std::cout << "X11 monitor stopped" << std::endl;
 }
 
 void X11Monitor::Stop() {
     running_ = false;
+    
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+    }
+}
+
+void X11Monitor::RequestFormat(const std::string& mime_type, FormatCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        // Run() sets running_ to false before failing the queue, so a request
+        // queued here is always completed
+        if (running_) {
+            pending_formats_.push_back({mime_type, std::move(callback)});
+            callback = nullptr;
+        }
+    }
+    
+    if (callback) {
+        callback(nullptr);
+        return;
+    }
+    
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+}
+
+void X11Monitor::SetSelection(ClipboardDataPtr content, OwnershipCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (running_) {
+            pending_selections_.push_back({std::move(content), std::move(callback)});
+            callback = nullptr;
+        }
+    }
+    
+    if (callback) {
+        callback(false);
+        return;
+    }
+    
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+}
+
+void X11Monitor::StartPendingFormat() {
+    while (true) {
+        PendingFormat pending;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            if (pending_formats_.empty()) {
+                return;
+            }
+            pending = std::move(pending_formats_.front());
+            pending_formats_.pop_front();
+        }
+        
+        auto it = std::find(available_target_names_.begin(), available_target_names_.end(),
+                            pending.mime_type);
+        if (it == available_target_names_.end()) {
+            std::cout << "   ⏭️  Format not offered: " << pending.mime_type << std::endl;
+            pending.callback(nullptr);
+            continue;
+        }
+        
+        // Converted against the current ownership, so a newer owner's reply
+        // is never mistaken for it
+        request_ = ConversionRequest();
+        request_.active = true;
+        request_.selection = clipboard_atom_;
+        request_.time = selection_time_;
+        request_.target_name = *it;
+        request_.target_names = available_target_names_;
+        request_.callback = std::move(pending.callback);
+        request_.result.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+        request_.result.source_app = GetActiveWindowName();
+        request_.result.window_title = request_.result.source_app;
+        
+        RequestConversion(available_targets_[it - available_target_names_.begin()]);
+        return;
+    }
+}
+
+void X11Monitor::FailPendingFormats() {
+    std::deque<PendingFormat> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_formats_);
+    }
+    
+    for (auto& request : pending) {
+        request.callback(nullptr);
+    }
+}
+
+void X11Monitor::StartPendingSelection() {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (pending_selections_.empty()) {
+            return;
+        }
+        acquiring_ = std::move(pending_selections_.front());
+        pending_selections_.pop_front();
+    }
+    
+    // Ownership must not be taken at CurrentTime; a zero-length append to our
+    // own window makes the server report its time in a PropertyNotify
+    static const unsigned char nothing = 0;
+    XChangeProperty(display_, window_, ownership_time_atom_, XA_INTEGER, 8,
+                    PropModeAppend, &nothing, 0);
+    XFlush(display_);
+}
+
+void X11Monitor::FailPendingSelections() {
+    std::deque<PendingSelection> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_selections_);
+    }
+    
+    if (acquiring_.callback) {
+        pending.push_front(std::move(acquiring_));
+        acquiring_ = PendingSelection();
+    }
+    
+    for (auto& request : pending) {
+        request.callback(false);
+    }
+}
+
+void X11Monitor::CompleteOwnership(Time time) {
+    if (!acquiring_.callback) {
+        return;
+    }
+    
+    PendingSelection request = std::move(acquiring_);
+    acquiring_ = PendingSelection();
+    
+    XSetSelectionOwner(display_, clipboard_atom_, window_, time);
+    if (XGetSelectionOwner(display_, clipboard_atom_) != window_) {
+        std::cerr << "Failed to take clipboard selection" << std::endl;
+        request.callback(false);
+        return;
+    }
+    
+    owned_content_ = std::move(request.content);
+    owned_time_ = time;
+    
+    // One round trip for all offered targets
+    const auto& names = owned_content_->available_mime_types;
+    std::vector<char*> name_ptrs;
+    for (const auto& name : names) {
+        name_ptrs.push_back(const_cast<char*>(name.c_str()));
+    }
+    owned_targets_.assign(names.size(), None);
+    if (!names.empty()) {
+        XInternAtoms(display_, name_ptrs.data(), name_ptrs.size(), False, owned_targets_.data());
+    }
+    
+    std::cout << "📌 Took clipboard selection (" << owned_content_->data.size()
+              << " bytes)" << std::endl;
+    request.callback(true);
+}
+
+void X11Monitor::HandleOwnedSelectionRequest(const XSelectionRequestEvent& event) {
+    XSelectionEvent reply{};
+    reply.type = SelectionNotify;
+    reply.display = event.display;
+    reply.requestor = event.requestor;
+    reply.selection = event.selection;
+    reply.target = event.target;
+    reply.time = event.time;
+    reply.property = None;
+    
+    // Obsolete requestors leave the choice of property to the owner
+    Atom property = event.property != None ? event.property : event.target;
+    
+    // Requests from before we took the selection are refused
+    bool owned = owned_content_ && event.selection == clipboard_atom_ &&
+                 (event.time == CurrentTime || event.time >= owned_time_);
+    
+    if (owned && ConvertOwnedSelection(event, property)) {
+        reply.property = property;
+    }
+    
+    XSendEvent(display_, event.requestor, False, NoEventMask, reinterpret_cast<XEvent*>(&reply));
+    XFlush(display_);
+}
+
+bool X11Monitor::ConvertOwnedSelection(const XSelectionRequestEvent& event, Atom property) {
+    if (event.target == targets_atom_) {
+        std::vector<long> targets = { static_cast<long>(targets_atom_),
+                                      static_cast<long>(timestamp_atom_) };
+        targets.insert(targets.end(), owned_targets_.begin(), owned_targets_.end());
+        XChangeProperty(display_, event.requestor, property, XA_ATOM, 32, PropModeReplace,
+                        reinterpret_cast<const unsigned char*>(targets.data()), targets.size());
+        return true;
+    }
+    
+    if (event.target == timestamp_atom_) {
+        long time = static_cast<long>(owned_time_);
+        XChangeProperty(display_, event.requestor, property, XA_INTEGER, 32, PropModeReplace,
+                        reinterpret_cast<const unsigned char*>(&time), 1);
+        return true;
+    }
+    
+    // MULTIPLE and anything not offered are refused
+    if (std::find(owned_targets_.begin(), owned_targets_.end(), event.target) == owned_targets_.end()) {
+        return false;
+    }
+    
+    // Every offered target is the same bytes; TEXT is answered as UTF-8
+    Atom type = event.target == text_atom_ ? utf8_string_atom_ : event.target;
+    const auto& data = owned_content_->data;
+    
+    if (data.size() <= kIncrChunkBytes) {
+        XChangeProperty(display_, event.requestor, property, type, 8, PropModeReplace,
+                        data.data(), data.size());
+        return true;
+    }
+    
+    // Larger content goes in chunks, each one requested by the requestor
+    // deleting the previous property value
+    XSelectInput(display_, event.requestor, PropertyChangeMask);
+    long size = static_cast<long>(data.size());
+    XChangeProperty(display_, event.requestor, property, incr_atom_, 32, PropModeReplace,
+                    reinterpret_cast<const unsigned char*>(&size), 1);
+    
+    IncrementalSend send;
+    send.requestor = event.requestor;
+    send.property = property;
+    send.type = type;
+    send.content = owned_content_;
+    send.offset = 0;
+    send.deadline = std::chrono::steady_clock::now() + kSelectionTimeout;
+    incremental_sends_.push_back(std::move(send));
+    return true;
+}
+
+void X11Monitor::HandleIncrementalSend(const XPropertyEvent& event) {
+    if (event.state != PropertyDelete) {
+        return;
+    }
+    
+    for (size_t i = 0; i < incremental_sends_.size(); i++) {
+        IncrementalSend& send = incremental_sends_[i];
+        if (send.requestor != event.window || send.property != event.atom) {
+            continue;
+        }
+        
+        const auto& data = send.content->data;
+        size_t length = std::min(kIncrChunkBytes, data.size() - send.offset);
+        XChangeProperty(display_, send.requestor, send.property, send.type, 8, PropModeReplace,
+                        data.data() + send.offset, length);
+        XFlush(display_);
+        
+        // The zero-length chunk after the last one ends the transfer
+        if (length == 0) {
+            EndIncrementalSend(i);
+            return;
+        }
+        
+        send.offset += length;
+        send.deadline = std::chrono::steady_clock::now() + kSelectionTimeout;
+        return;
+    }
+}
+
+void X11Monitor::ExpireIncrementalSends() {
+    auto now = std::chrono::steady_clock::now();
+    
+    for (size_t i = incremental_sends_.size(); i-- > 0;) {
+        if (now >= incremental_sends_[i].deadline) {
+            std::cerr << "Requestor stopped reading the clipboard ("
+                      << incremental_sends_[i].offset << " bytes sent)" << std::endl;
+            EndIncrementalSend(i);
+        }
+    }
+}
+
+void X11Monitor::EndIncrementalSend(size_t index) {
+    Window requestor = incremental_sends_[index].requestor;
+    incremental_sends_.erase(incremental_sends_.begin() + index);
+    
+    // Our own window keeps PropertyChangeMask for its INCR reads
+    bool in_use = std::any_of(incremental_sends_.begin(), incremental_sends_.end(),
+        [requestor](const IncrementalSend& send) { return send.requestor == requestor; });
+    if (requestor != window_ && !in_use) {
+        XSelectInput(display_, requestor, NoEventMask);
+    }
+}
+
+void X11Monitor::AbortRequest(const std::string& reason) {
+    request_.active = false;
+    std::cerr << "Error reading clipboard: " << reason << std::endl;
+    
+    RecordRead(request_.target == targets_atom_ ? "TARGETS" : request_.target_name,
+               request_.result.data.size(),
+               std::chrono::steady_clock::now() - request_.started, false);
+    
+    if (request_.callback) {
+        FormatCallback callback = std::move(request_.callback);
+        request_.callback = nullptr;
+        callback(nullptr);
+    }
+}
+
+void X11Monitor::HandleEvent(XEvent& event) {
+    if (event.type == xfixes_event_base_ + XFixesSelectionNotify) {
+        auto* selection_event = reinterpret_cast<XFixesSelectionNotifyEvent*>(&event);
+        HandleSelectionNotify(*selection_event);
+    } else if (event.type == SelectionNotify && event.xselection.requestor == window_) {
+        HandleConversionNotify(event.xselection);
+    } else if (event.type == SelectionRequest && event.xselectionrequest.owner == window_) {
+        HandleOwnedSelectionRequest(event.xselectionrequest);
+    } else if (event.type == SelectionClear && event.xselectionclear.selection == clipboard_atom_ &&
+               event.xselectionclear.time >= owned_time_) {
+        // Another client took the selection; INCR sends in progress still finish
+        owned_content_.reset();
+        owned_targets_.clear();
+    } else if (event.type == PropertyNotify && event.xproperty.window == window_ &&
+               event.xproperty.atom == ownership_time_atom_) {
+        CompleteOwnership(event.xproperty.time);
+    } else if (event.type == PropertyNotify && event.xproperty.state == PropertyNewValue &&
+               event.xproperty.window == window_) {
+        HandleIncrementalChunk(event.xproperty);
+    } else if (event.type == PropertyNotify) {
+        // Requestors delete each INCR chunk we wrote to ask for the next
+        HandleIncrementalSend(event.xproperty);
+    }
 }
 
 void X11Monitor::HandleSelectionNotify(const XFixesSelectionNotifyEvent& event) {
+    if (event.selection == XA_PRIMARY) {
+        // Every drag step changes the owner's timestamp; only restart the
+        // quiet period here
+        primary_pending_ = event.owner != None && IsPrimarySelectionEnabled();
+        primary_time_ = event.selection_timestamp;
+        primary_deadline_ = std::chrono::steady_clock::now() + kPrimarySettleDelay;
+        return;
+    }
+    
     if (event.selection != clipboard_atom_) {
         return;
     }
     
     std::cout << "Clipboard changed" << std::endl;
     
-    try {
-        auto data = ReadClipboardContent();
-        
-        if (OnClipboardChanged) {
-            OnClipboardChanged(data);
+    available_targets_.clear();
+    available_target_names_.clear();
+    selection_time_ = event.selection_timestamp;
+    
+    // Clipboard cleared, nothing to convert
+    if (event.owner == None) {
+        return;
+    }
+    
+    // Our own selection is already in memory, no need to convert it
+    if (event.owner == window_ && owned_content_) {
+        if (request_.active && request_.selection == clipboard_atom_) {
+            AbortRequest("Selection owner changed");
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Error reading clipboard: " << e.what() << std::endl;
+        
+        std::cout << "   Owned by daemon" << std::endl;
+        available_targets_ = owned_targets_;
+        available_target_names_ = owned_content_->available_mime_types;
+        NotifyClipboardChanged(owned_content_);
+        return;
     }
+    
+    StartSelectionRequest(clipboard_atom_, event.selection_timestamp);
 }
 
-ClipboardData X11Monitor::ReadClipboardContent() {
-    ClipboardData result;
-    result.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+void X11Monitor::StartSelectionRequest(Atom selection, Time time) {
+    if (request_.active && request_.callback) {
+        AbortRequest("Selection owner changed");
+    }
+    
+    // A superseded primary conversion is retried once the slot is free
+    if (request_.active && request_.selection == XA_PRIMARY) {
+        primary_pending_ = true;
+    }
+    
+    // A new owner supersedes a request still in flight; its reply is told
+    // apart by the request time
+    request_ = ConversionRequest();
+    request_.active = true;
+    request_.selection = selection;
+    request_.time = time;
+    
+    request_.result.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::system_clock::now().time_since_epoch()
     ).count();
     
     // Get active window info
-    result.source_app = GetActiveWindowName();
-    result.window_title = result.source_app; // Simplified for now
+    request_.result.source_app = GetActiveWindowName();
+    request_.result.window_title = request_.result.source_app; // Simplified for now
+    
+    // Ask for the available formats first, once per ownership change
+    RequestConversion(targets_atom_);
+}
+
+void X11Monitor::RequestConversion(Atom target) {
+    request_.target = target;
+    request_.incremental = false;
+    request_.hasher = ContentHasher();
+    request_.started = std::chrono::steady_clock::now();
+    request_.deadline = request_.started + kSelectionTimeout;
     
-    // Request clipboard content
+    // Request clipboard content; the answer arrives as a SelectionNotify
     XConvertSelection(
         display_,
-        clipboard_atom_,
-        utf8_string_atom_,
+        request_.selection,
+        request_.target,
         clipboard_atom_,
         window_,
-        CurrentTime
+        request_.time
     );
     
     XFlush(display_);
+}
+
+void X11Monitor::HandleConversionNotify(const XSelectionEvent& event) {
+    // Some owners answer with CurrentTime instead of echoing the request time
+    if (!request_.active || request_.incremental || event.selection != request_.selection ||
+        event.target != request_.target ||
+        (event.time != request_.time && event.time != CurrentTime)) {
+        return;
+    }
     
-    // Wait for SelectionNotify event
-    XEvent event;
-    bool received = false;
-    auto start = std::chrono::steady_clock::now();
-    
-    while (!received && 
-           std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
-        if (XCheckTypedWindowEvent(display_, window_, SelectionNotify, &event)) {
-            received = true;
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    // Owners without TARGETS support still get a plain text request
+    if (event.property == None && request_.target == targets_atom_) {
+        request_.target_name = "UTF8_STRING";
+        RequestConversion(utf8_string_atom_);
+        return;
+    }
+    
+    if (event.property == None) {
+        AbortRequest("Owner refused conversion");
+        return;
+    }
+    
+    try {
+        std::vector<uint8_t> value;
+        Atom type = ReadSelectionProperty(value);
+        
+        if (type == incr_atom_) {
+            // Deleting the INCR property starts the transfer; its value is
+            // a lower bound for the total size
+            long size_hint = 0;
+            if (value.size() >= sizeof(long)) {
+                std::memcpy(&size_hint, value.data(), sizeof(long));
+            }
+            if (size_hint > 0) {
+                request_.result.data.reserve(
+                    std::min<size_t>(static_cast<size_t>(size_hint), kMaxSelectionBytes));
+            }
+            
+            request_.incremental = true;
+            request_.deadline = std::chrono::steady_clock::now() + kSelectionTimeout;
+            return;
         }
+        
+        request_.hasher.Update(value.data(), value.size());
+        request_.result.data = std::move(value);
+        CompleteSelectionRequest();
+    } catch (const std::exception& e) {
+        AbortRequest(e.what());
+    }
+}
+
+void X11Monitor::HandleIncrementalChunk(const XPropertyEvent& event) {
+    if (!request_.active || !request_.incremental ||
+        event.atom != clipboard_atom_ || event.state != PropertyNewValue) {
+        return;
     }
     
-    if (!received) {
-        throw std::runtime_error("Timeout waiting for clipboard data");
+    try {
+        // Chunks are appended straight into the reserved result buffer
+        auto& data = request_.result.data;
+        size_t before = data.size();
+        ReadSelectionProperty(data);
+        request_.hasher.Update(data.data() + before, data.size() - before);
+        
+        if (data.size() == before) {
+            // Zero-length chunk marks the end of the transfer
+            CompleteSelectionRequest();
+            return;
+        }
+        
+        request_.deadline = std::chrono::steady_clock::now() + kSelectionTimeout;
+    } catch (const std::exception& e) {
+        AbortRequest(e.what());
+    }
+}
+
+void X11Monitor::CompleteSelectionRequest() {
+    if (request_.target == targets_atom_) {
+        std::vector<uint8_t> value = std::move(request_.result.data);
+        request_.result.data.clear();
+        HandleTargets(value);
+        return;
     }
     
-    // Read the property
-    Atom actual_type;
-    int actual_format;
-    unsigned long nitems, bytes_after;
-    unsigned char* prop_data = nullptr;
+    request_.active = false;
     
-    int status = XGetWindowProperty(
-        display_,
-        window_,
-        clipboard_atom_,
-        0, ~0L, False,
-        AnyPropertyType,
-        &actual_type,
-        &actual_format,
-        &nitems,
-        &bytes_after,
-        &prop_data
-    );
+    RecordRead(request_.target_name, request_.result.data.size(),
+               std::chrono::steady_clock::now() - request_.started, true);
     
-    if (status != Success || !prop_data) {
-        throw std::runtime_error("Failed to read clipboard property");
+    ClipboardData result = std::move(request_.result);
+    
+    // Determine MIME type from the negotiated target
+    result.mime_type = MimeTypeForTarget(request_.target_name);
+    result.content_type = ContentTypeForMime(result.mime_type);
+    result.content_hash = request_.hasher.Finish();
+    result.available_mime_types = request_.target_names;
+    result.selection = request_.selection == XA_PRIMARY ? Selection::PRIMARY : Selection::CLIPBOARD;
+    
+    // On-demand formats go to the requester only, they are not a new capture
+    if (request_.callback) {
+        FormatCallback callback = std::move(request_.callback);
+        request_.callback = nullptr;
+        callback(result.data.empty() ? nullptr
+                                     : std::make_shared<const ClipboardData>(std::move(result)));
+        return;
     }
     
-    // Copy data
-    result.data.assign(prop_data, prop_data + nitems);
-    XFree(prop_data);
+    NotifyClipboardChanged(std::move(result));
+}
+
+void X11Monitor::HandleTargets(const std::vector<uint8_t>& value) {
+    // TARGETS is a list of atoms, handed out by Xlib as longs
+    std::vector<Atom> targets;
+    size_t count = value.size() / sizeof(long);
+    for (size_t i = 0; i < count; i++) {
+        long atom = 0;
+        std::memcpy(&atom, value.data() + i * sizeof(long), sizeof(long));
+        targets.push_back(static_cast<Atom>(atom));
+    }
     
-    // Determine MIME type
-    if (actual_type == utf8_string_atom_ || actual_type == XA_STRING) {
-        result.mime_type = "text/plain";
-        result.content_type = ContentType::TEXT;
-    } else if (actual_type == png_atom_) {
-        result.mime_type = "image/png";
-        result.content_type = ContentType::IMAGE;
-    } else {
-        result.mime_type = "application/octet-stream";
-        result.content_type = ContentType::UNKNOWN;
+    // One round trip for all names; control targets are not content formats
+    std::vector<Atom> content_targets;
+    std::vector<std::string> content_names;
+    
+    std::vector<char*> names(targets.size(), nullptr);
+    if (!targets.empty() &&
+        XGetAtomNames(display_, targets.data(), targets.size(), names.data())) {
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (!names[i]) {
+                continue;
+            }
+            
+            std::string name(names[i]);
+            XFree(names[i]);
+            
+            if (!IsMetadataMimeType(name)) {
+                content_targets.push_back(targets[i]);
+                content_names.push_back(std::move(name));
+            }
+        }
     }
     
-    return result;
+    // Only CLIPBOARD formats can be requested on demand
+    if (request_.selection == clipboard_atom_) {
+        available_targets_ = content_targets;
+        available_target_names_ = content_names;
+    }
+    
+    std::string target_name;
+    Atom target = ChooseTarget(content_targets, content_names, target_name);
+    request_.target_names = std::move(content_names);
+    
+    if (target == None) {
+        request_.active = false;
+        std::cout << "   ⏭️  No supported clipboard target offered, ignoring" << std::endl;
+        return;
+    }
+    
+    std::cout << "   Selected target: " << target_name << std::endl;
+    request_.target_name = target_name;
+    RequestConversion(target);
+}
+
+Atom X11Monitor::ChooseTarget(
+    const std::vector<Atom>& targets,
+    const std::vector<std::string>& names,
+    std::string& target_name)
+{
+    // Empty or unreadable TARGETS: plain text is the safest guess
+    if (targets.empty()) {
+        target_name = "UTF8_STRING";
+        return utf8_string_atom_;
+    }
+    
+    Atom best = None;
+    size_t best_rank = target_priority_.size();
+    
+    for (size_t i = 0; i < targets.size(); i++) {
+        const std::string& name = names[i];
+        
+        for (size_t rank = 0; rank < best_rank; rank++) {
+            if (MatchesMimePattern(name, target_priority_[rank])) {
+                best = targets[i];
+                best_rank = rank;
+                target_name = name;
+                break;
+            }
+        }
+    }
+    
+    return best;
+}
+
+Atom X11Monitor::ReadSelectionProperty(std::vector<uint8_t>& buffer) {
+    // Read the property in bounded pieces until bytes_after is exhausted,
+    // then delete it (which also acknowledges an INCR chunk)
+    Atom actual_type = None;
+    long offset = 0;
+    unsigned long bytes_after = 0;
+    
+    do {
+        int actual_format = 0;
+        unsigned long nitems = 0;
+        unsigned char* prop_data = nullptr;
+        
+        int status = XGetWindowProperty(
+            display_,
+            window_,
+            clipboard_atom_,
+            offset, kPropertyChunkLongs, False,
+            AnyPropertyType,
+            &actual_type,
+            &actual_format,
+            &nitems,
+            &bytes_after,
+            &prop_data
+        );
+        
+        if (status != Success) {
+            throw std::runtime_error("Failed to read clipboard property");
+        }
+        
+        // Xlib hands out format 32 items as longs
+        size_t item_size = actual_format == 32 ? sizeof(long) : actual_format / 8;
+        size_t length = nitems * item_size;
+        
+        if (buffer.size() + length > kMaxSelectionBytes) {
+            XFree(prop_data);
+            XDeleteProperty(display_, window_, clipboard_atom_);
+            throw std::runtime_error("Clipboard data exceeds " +
+                                     std::to_string(kMaxSelectionBytes) + " bytes");
+        }
+        
+        if (prop_data) {
+            buffer.insert(buffer.end(), prop_data, prop_data + length);
+            XFree(prop_data);
+        }
+        
+        offset += kPropertyChunkLongs;
+    } while (bytes_after > 0);
+    
+    XDeleteProperty(display_, window_, clipboard_atom_);
+    return actual_type;
+}
+
+int X11Monitor::NextPollTimeout() const {
+    // Fully event driven while idle; only a pending request, a settling
+    // primary selection or an INCR send needs a deadline
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    if (request_.active) {
+        deadline = request_.deadline;
+    } else if (primary_pending_) {
+        deadline = primary_deadline_;
+    }
+    for (const auto& send : incremental_sends_) {
+        deadline = std::min(deadline, send.deadline);
+    }
+    
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+        return -1;
+    }
+    
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count();
+    return remaining > 0 ? static_cast<int>(remaining) : 0;
 }
 
 std::string X11Monitor::GetActiveWindowName() {
@@ -271,15 +982,16 @@ std::string X11Monitor::GetWindowProperty(Window window, Atom property) {
     return result;
 }
 
-ContentType X11Monitor::DetectContentType(const std::string& mime_type) {
-    if (mime_type.find("text/") == 0) {
-        return ContentType::TEXT;
-    } else if (mime_type.find("image/") == 0) {
-        return ContentType::IMAGE;
-    } else if (mime_type.find("text/html") == 0) {
-        return ContentType::HTML;
+std::string X11Monitor::MimeTypeForTarget(const std::string& target_name) {
+    // Legacy X11 text targets
+    if (target_name == "UTF8_STRING" || target_name == "STRING" ||
+        target_name == "TEXT" || target_name == "COMPOUND_TEXT") {
+        return "text/plain";
+    }
+    if (target_name.empty()) {
+        return "application/octet-stream";
     }
-    return ContentType::UNKNOWN;
+    return target_name;
 }
 
 } // namespace clipboard
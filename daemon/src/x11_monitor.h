@@ -5,10 +5,29 @@
 #include <X11/Xatom.h>
 #include <X11/extensions/Xfixes.h>
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace clipboard {
 
+// Owners that do not answer a conversion (or the next INCR chunk) within
+// this time are skipped
+constexpr std::chrono::milliseconds kSelectionTimeout(1000);
+
+// Selections larger than this are dropped
+constexpr size_t kMaxSelectionBytes = 256 * 1024 * 1024;
+
+// XGetWindowProperty read size, in 32-bit units
+constexpr long kPropertyChunkLongs = 256 * 1024;
+
+// Owned content larger than this is served to requestors in INCR chunks of
+// this size, below the core protocol request limit even without BIG-REQUESTS
+constexpr size_t kIncrChunkBytes = 64 * 1024;
+
 class X11Monitor : public IClipboardMonitor {
 public:
     X11Monitor();
@@ -18,13 +37,86 @@ public:
     void Run() override;
     void Stop() override;
     bool IsRunning() const override { return running_; }
+    
+    // Target names in order of preference when picking from TARGETS. A
+    // trailing '*' matches by prefix ("image/*"). Also read from the
+    // comma-separated CLIPBOARD_TARGET_PRIORITY environment variable.
+    void SetTargetPriority(std::vector<std::string> priority);
+    
+    // Converts another advertised target once no other conversion is in flight
+    void RequestFormat(const std::string& mime_type, FormatCallback callback) override;
+    
+    // Becomes the CLIPBOARD owner with our window and answers conversion
+    // requests from memory
+    void SetSelection(ClipboardDataPtr content, OwnershipCallback callback) override;
 
 private:
+    // In-flight XConvertSelection, completed by the matching SelectionNotify
+    // or, for INCR transfers, by the final zero-length PropertyNotify chunk.
+    // On-demand format conversions carry the requester's callback.
+    struct ConversionRequest {
+        bool active = false;
+        bool incremental = false;
+        Atom selection = None;
+        Time time = CurrentTime;
+        Atom target = None;
+        std::string target_name;
+        std::vector<std::string> target_names;
+        ClipboardData result;
+        ContentHasher hasher;
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point deadline;
+        FormatCallback callback;
+    };
+    
+    struct PendingFormat {
+        std::string mime_type;
+        FormatCallback callback;
+    };
+    
+    struct PendingSelection {
+        ClipboardDataPtr content;
+        OwnershipCallback callback;
+    };
+    
+    // Owned content sent to a requestor in INCR chunks, each written once
+    // the requestor deleted the previous one
+    struct IncrementalSend {
+        Window requestor;
+        Atom property;
+        Atom type;
+        ClipboardDataPtr content;
+        size_t offset;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    
+    void HandleEvent(XEvent& event);
     void HandleSelectionNotify(const XFixesSelectionNotifyEvent& event);
-    ClipboardData ReadClipboardContent();
+    void StartSelectionRequest(Atom selection, Time time);
+    void StartPendingFormat();
+    void FailPendingFormats();
+    void StartPendingSelection();
+    void FailPendingSelections();
+    void CompleteOwnership(Time time);
+    void HandleOwnedSelectionRequest(const XSelectionRequestEvent& event);
+    bool ConvertOwnedSelection(const XSelectionRequestEvent& event, Atom property);
+    void HandleIncrementalSend(const XPropertyEvent& event);
+    void ExpireIncrementalSends();
+    void EndIncrementalSend(size_t index);
+    void AbortRequest(const std::string& reason);
+    void RequestConversion(Atom target);
+    void HandleTargets(const std::vector<uint8_t>& value);
+    Atom ChooseTarget(const std::vector<Atom>& targets,
+                      const std::vector<std::string>& names,
+                      std::string& target_name);
+    void HandleConversionNotify(const XSelectionEvent& event);
+    void HandleIncrementalChunk(const XPropertyEvent& event);
+    void CompleteSelectionRequest();
+    Atom ReadSelectionProperty(std::vector<uint8_t>& buffer);
+    int NextPollTimeout() const;
     std::string GetActiveWindowName();
     std::string GetWindowProperty(Window window, Atom property);
-    ContentType DetectContentType(const std::string& mime_type);
+    std::string MimeTypeForTarget(const std::string& target_name);
     
     Display* display_;
     Window window_;
@@ -33,9 +125,42 @@ private:
     Atom targets_atom_;
     Atom text_atom_;
     Atom png_atom_;
+    Atom incr_atom_;
+    Atom timestamp_atom_;
+    Atom ownership_time_atom_;
+    
+    std::vector<std::string> target_priority_;
+    
+    // TARGETS advertised by the current owner and their names; formats other
+    // than the one captured are only converted on demand
+    std::vector<Atom> available_targets_;
+    std::vector<std::string> available_target_names_;
+    Time selection_time_;
+    
+    // Latest PRIMARY ownership, converted once it stopped changing for
+    // kPrimarySettleDelay
+    bool primary_pending_;
+    Time primary_time_;
+    std::chrono::steady_clock::time_point primary_deadline_;
     
     std::atomic<bool> running_;
     int xfixes_event_base_;
+    ConversionRequest request_;
+    
+    // CLIPBOARD content owned by our window, its targets and the server
+    // time ownership was taken at. A takeover waits for that time, which
+    // arrives as a PropertyNotify for ownership_time_atom_.
+    ClipboardDataPtr owned_content_;
+    std::vector<Atom> owned_targets_;
+    Time owned_time_;
+    PendingSelection acquiring_;
+    std::vector<IncrementalSend> incremental_sends_;
+    
+    // Wakes Run() for Stop() and queued requests
+    int wake_fd_;
+    std::mutex pending_mutex_;
+    std::deque<PendingFormat> pending_formats_;
+    std::deque<PendingSelection> pending_selections_;
 };
 
 } // namespace clipboard